@@ -0,0 +1,118 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "AllocTracker.h"
+
+#ifdef RT4_TRACK_ALLOCS
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+using namespace std;
+
+// Plain counters, they must work before any static initialization
+static thread_local long long allocations = 0;
+static thread_local bool bNoAllocSection = false;
+static atomic<long long> forbidden(0);
+
+long long threadAllocations()
+{
+    return allocations;
+}
+
+void beginNoAllocSection()
+{
+    bNoAllocSection = true;
+}
+
+void endNoAllocSection()
+{
+    bNoAllocSection = false;
+}
+
+long long forbiddenAllocations()
+{
+    return forbidden;
+}
+
+static void *trackedAlloc(size_t size)
+{
+    ++allocations;
+    if (bNoAllocSection)
+        ++forbidden;
+    return malloc(size ? size : 1);
+}
+
+static void *trackedAlignedAlloc(size_t size, size_t alignment)
+{
+    ++allocations;
+    if (bNoAllocSection)
+        ++forbidden;
+    void *p = NULL;
+    if (posix_memalign(&p, alignment < sizeof(void *) ? sizeof(void *) : alignment, size ? size : 1) != 0)
+        return NULL;
+    return p;
+}
+
+void *operator new(size_t size)
+{
+    void *p = trackedAlloc(size);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    void *p = trackedAlloc(size);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+    return trackedAlloc(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+    return trackedAlloc(size);
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const nothrow_t &) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+#if __cplusplus >= 201703L
+void *operator new(size_t size, align_val_t alignment)
+{
+    void *p = trackedAlignedAlloc(size, size_t(alignment));
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size, align_val_t alignment)
+{
+    void *p = trackedAlignedAlloc(size, size_t(alignment));
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+
+void operator delete(void *p, align_val_t) noexcept { free(p); }
+void operator delete[](void *p, align_val_t) noexcept { free(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { free(p); }
+void operator delete[](void *p, size_t, align_val_t) noexcept { free(p); }
+#endif
+
+#endif // RT4_TRACK_ALLOCS
@@ -0,0 +1,38 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __ALLOC_TRACKER_H
+#define __ALLOC_TRACKER_H
+
+// Heap allocation tracking, only when compiling with RT4_TRACK_ALLOCS defined
+// (make rt4-alloc). The global operator new is then replaced to count the
+// allocations of each thread, and every allocation made inside a section
+// declared allocation free (the pixel loop) is counted as forbidden.
+// In other builds these functions do nothing and the counts read as -1.
+
+#ifdef RT4_TRACK_ALLOCS
+
+// Allocations made by the calling thread so far
+long long threadAllocations();
+
+void beginNoAllocSection();
+void endNoAllocSection();
+
+// Allocations made inside allocation free sections, by any thread
+long long forbiddenAllocations();
+
+#else
+
+inline long long threadAllocations() { return -1; }
+inline void beginNoAllocSection() {}
+inline void endNoAllocSection() {}
+inline long long forbiddenAllocations() { return -1; }
+
+#endif // RT4_TRACK_ALLOCS
+
+#endif //__ALLOC_TRACKER_H
@@ -0,0 +1,169 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+#include "Animation.h"
+#include "Config.h"
+#include "Scene.h"
+
+static bool isLessFrame(const keyframe &key1, const keyframe &key2)
+{
+    return key1.frame < key2.frame;
+}
+
+// Finds the track of that variable, or adds it
+static animationTrack &findTrack(vector<animationTrack> &tracks, int target, int object, int center)
+{
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (tracks[i].target == target && tracks[i].object == object && tracks[i].center == center)
+            return tracks[i];
+    }
+    animationTrack track;
+    track.target = animationTrack::targetType(target);
+    track.object = object;
+    track.center = center;
+    tracks.push_back(track);
+    return tracks.back();
+}
+
+bool readAnimationTracks(const Config &sceneFile, animatedSection section, int object,
+                         vector<animationTrack> &tracks)
+{
+    static const vecteur NullVector = { 0.0f,0.0f,0.0f };
+    for (int i = 0; i < sceneFile.GetEntryCount(); ++i)
+    {
+        SimpleString name = sceneFile.GetEntryName(i);
+        int at = name.find_last_of('@');
+        if (at < 0)
+            continue;
+        SimpleString variable = name.substr(0, at);
+        SimpleString frameString = name.substr(at + 1, name.size() - at - 1);
+        char *frameEnd;
+        long frame = strtol(frameString.c_str(), &frameEnd, 10);
+        if (frameString.empty() || *frameEnd != 0)
+        {
+            cout << "Mal formed Scene file : " << name.c_str() << " doesn't end with a frame number." << endl;
+            return false;
+        }
+
+        int target = -1, center = 0;
+        bool bVector = true;
+        if (section == animatedSphere && variable.compare("Center") == 0)
+            target = animationTrack::spherePosition;
+        else if (section == animatedSphere && variable.compare("Size") == 0)
+            target = animationTrack::sphereSize;
+        else if (section == animatedBlob && variable.compare("Size") == 0)
+            target = animationTrack::blobSize;
+        else if (section == animatedBlob && variable.size() > 6 && variable.substr(0, 6).compare("Center") == 0)
+        {
+            target = animationTrack::blobCenter;
+            center = atoi(variable.c_str() + 6);
+        }
+        else if (section == animatedLight && variable.compare("Position") == 0)
+            target = animationTrack::lightPosition;
+        else if (section == animatedLight && variable.compare("Intensity") == 0)
+            target = animationTrack::lightIntensity;
+        else if (section == animatedScene && variable.compare("Perspective.FOV") == 0)
+            target = animationTrack::cameraFOV;
+        else if (section == animatedScene && variable.compare("Perspective.ClearPoint") == 0)
+            target = animationTrack::cameraClearPoint;
+        else if (section == animatedScene && variable.compare("Perspective.Dispersion") == 0)
+            target = animationTrack::cameraDispersion;
+        if (target == -1)
+        {
+            cout << "Mal formed Scene file : " << variable.c_str() << " can't be animated." << endl;
+            return false;
+        }
+        bVector = target == animationTrack::spherePosition || target == animationTrack::blobCenter 
+               || target == animationTrack::lightPosition || target == animationTrack::lightIntensity;
+
+        keyframe key;
+        key.frame = int(frame);
+        if (bVector)
+        {
+            // Like the intensity of the lights, a single number is the same on the three axes
+            float fScalar = float(sceneFile.GetByNameAsFloat(name, 0.0f));
+            vecteur vScalar = {fScalar, fScalar, fScalar};
+            key.value = sceneFile.GetByNameAsVector(name, vScalar);
+        }
+        else
+        {
+            key.value = NullVector;
+            key.value.x = float(sceneFile.GetByNameAsFloat(name, 0.0f));
+        }
+        animationTrack &track = findTrack(tracks, target, object, center);
+        track.keys.push_back(key);
+        sort(track.keys.begin(), track.keys.end(), isLessFrame);
+    }
+    return true;
+}
+
+static vecteur interpolate(const vector<keyframe> &keys, int frame)
+{
+    if (frame <= keys.front().frame)
+        return keys.front().value;
+    if (frame >= keys.back().frame)
+        return keys.back().value;
+    size_t i = 1;
+    while (keys[i].frame < frame)
+        ++i;
+    const keyframe &key1 = keys[i - 1], &key2 = keys[i];
+    float t = float(frame - key1.frame) / float(key2.frame - key1.frame);
+    return key1.value + t * (key2.value - key1.value);
+}
+
+void animateScene(scene &myScene, int frame)
+{
+    for (size_t i = 0; i < myScene.animation.size(); ++i)
+    {
+        const animationTrack &track = myScene.animation[i];
+        vecteur value = interpolate(track.keys, frame);
+        point position = {value.x, value.y, value.z};
+        switch (track.target)
+        {
+        case animationTrack::spherePosition:
+            myScene.sphereContainer[track.object].pos = position;
+            break;
+        case animationTrack::sphereSize:
+            myScene.sphereContainer[track.object].size = value.x;
+            break;
+        case animationTrack::blobCenter:
+            myScene.blobContainer[track.object].centerList[track.center] = position;
+            break;
+        case animationTrack::blobSize:
+            myScene.blobContainer[track.object].size = value.x;
+            myScene.blobContainer[track.object].invSizeSquare = 1.0f / (value.x * value.x);
+            break;
+        case animationTrack::lightPosition:
+            myScene.lightContainer[track.object].pos = position;
+            break;
+        case animationTrack::lightIntensity:
+            myScene.lightContainer[track.object].intensity.red = value.x;
+            myScene.lightContainer[track.object].intensity.green = value.y;
+            myScene.lightContainer[track.object].intensity.blue = value.z;
+            break;
+        case animationTrack::cameraFOV:
+            myScene.persp.FOV = value.x;
+            if (myScene.persp.type == perspective::conic)
+                myScene.persp.invProjectionDistance = 1.0f / (0.5f * myScene.sizex / tanf (float(PIOVER180) * 0.5f * myScene.persp.FOV));
+            break;
+        case animationTrack::cameraClearPoint:
+            myScene.persp.clearPoint = value.x;
+            break;
+        case animationTrack::cameraDispersion:
+            myScene.persp.dispersion = value.x;
+            break;
+        }
+    }
+}
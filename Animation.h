@@ -0,0 +1,62 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __ANIMATION_H
+#define __ANIMATION_H
+
+#include <vector>
+#include "Def.h"
+class Config;
+struct scene;
+
+// Keyframes are written like the variables they animate, followed by
+// @ and the frame number :
+//     Center@0 = 100.0, 200.0, 300.0;
+//     Center@120 = 500.0, 200.0, 300.0;
+// The values are interpolated linearly between the keys and keep the
+// value of the first or last key outside of them.
+struct keyframe {
+    int frame;
+    // Scalars only use x
+    vecteur value;
+};
+
+struct animationTrack {
+    enum targetType {
+        spherePosition,
+        sphereSize,
+        blobCenter,
+        blobSize,
+        lightPosition,
+        lightIntensity,
+        cameraFOV,
+        cameraClearPoint,
+        cameraDispersion
+    } target;
+    // Index of the sphere, blob or light and of the blob center
+    int object, center;
+    // Sorted by frame
+    std::vector<keyframe> keys;
+};
+
+enum animatedSection {
+    animatedScene,
+    animatedSphere,
+    animatedBlob,
+    animatedLight
+};
+
+// Reads the keyframes of the current section of the scene file.
+// Returns false, after saying why, when a key can't be animated.
+bool readAnimationTracks(const Config &sceneFile, animatedSection section, int object,
+                         std::vector<animationTrack> &tracks);
+
+// Moves everything that is animated to where it is at that frame
+void animateScene(scene &myScene, int frame);
+
+#endif //__ANIMATION_H
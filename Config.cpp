@@ -1,319 +1,605 @@
-/*
-    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
-    It is free to use for educational purpose and cannot be redistributed
-    outside of the tutorial pages.
-    Any further inquiry :
-    mailto:info@codermind.com
- */
-
-#include <cmath>
-#include <fstream>
-#include <map>
-#include <set>
-#include <string>
-#include "Config.h"
-
-#pragma warning(push)
-#pragma warning(disable:4996)
-
-// This is a simple config file parser.
-// It does what we need no more no less.
-
-typedef std::map<SimpleString,SimpleString> VariableSet;
-typedef std::set<SimpleString> StringSet;
-
-using namespace std;
-
-static SimpleString preprocess(fstream& InputFile) {
-    SimpleString tmp;
-    string line;
-    while (getline(InputFile,line, '\n')) {
-        // Get rid of C-Style comments 
-        line = line.substr(0,line.find("//"));
-        // Get rid of spaces/tabs/newlines. The basic syntax allows us to do that obviously.
-        for (string::iterator i = line.begin(); i != line.end(); ++i) {
-            switch (*i) {
-            case ' ':case '\t': case '\n': case '\r':
-                break;
-            default:
-              tmp.append(*i);
-            }
-        }
-    }
-    return tmp;
-}
-
-static bool preload(fstream& InputFile, VariableSet &variables, StringSet &sections) {
-    static SimpleString buf;
-    SimpleString tmp;
-    int recursion=0;
-    tmp = preprocess(InputFile);
-    SimpleString::iterator i=tmp.begin();
-    SimpleString tmpname;
-    SimpleString tmpvalue;
-    SimpleString currentSection;
-    
-findname:
-    if (i == tmp.end()) {
-        // We're done
-        goto end;
-    }
-    switch (*i) {
-    case '{':
-        if (sections.insert(tmpname).second == false) {
-            // There is already a section by that name !!
-            sections.clear();
-            variables.clear();
-            return false;
-        }
-        currentSection = tmpname;
-        tmpname.resize(0);
-        goto insection;
-        break;
-    default:
-        tmpname.append(&*i,1);
-    }
-    ++i;
-    goto findname;
-        
-insection:
-    if (i == tmp.end()) {
-        sections.clear();
-        variables.clear();
-        return false;
-    }
-    switch (*i) {
-    case '{':
-        ++recursion; 
-        break;
-    case '}':
-        --recursion;
-        if (recursion == 0) {
-            ++i;
-            // We finished extracting the variables, don't keep those around
-            currentSection.resize(0);
-            goto findname;
-        }
-        break;
-    default:
-        goto variablename;
-    }
-    ++i;
-    goto insection;
-    
-variablename:
-    if (i == tmp.end()) {
-            sections.clear();
-            variables.clear();
-        return false;
-    }
-    switch (*i) {
-    case '{':
-        // It was not a variable but the start of a new block
-        goto insection;
-    case '}':
-            sections.clear();
-            variables.clear();
-        return false;
-    case '=':
-        if (tmpname.empty()) {
-            sections.clear();
-            variables.clear();
-            return false;
-        }
-        ++i;
-        goto variablevalue;
-    default:
-        tmpname.append(&*i,1);
-        break;
-    }
-    ++i;
-    goto variablename;    
-    
-variablevalue:
-    if (i == tmp.end()) {
-            sections.clear();
-            variables.clear();
-        return false;
-    }
-    switch (*i) {
-    case '{':
-            sections.clear();
-            variables.clear();
-        return false;
-    case '}':
-            sections.clear();
-            variables.clear();
-        return false;
-    case ';':
-        if (tmpvalue.empty()) {
-            sections.clear();
-            variables.clear();
-            return false;
-        }
-        // We store the variable with the name of the section as a prefix
-        buf.assign(currentSection);
-        buf.append('/');
-        buf.append(tmpname);
-        variables.insert(VariableSet::value_type(buf, tmpvalue));
-        tmpname.resize(0);
-        tmpvalue.resize(0);
-        ++i;
-        goto insection;
-    default:
-        tmpvalue.append(i,1);
-        break;
-    }
-    ++i;
-    goto variablevalue;    
-end:
-    return true;
-}
-
-Config::Config(const SimpleString &sFileName) :
-m_pVariables(NULL),
-m_pSections(NULL),
-m_sFileName(sFileName),
-m_bLoaded(false)
-{
-}
-
-Config::~Config()
-{
-    if (m_pVariables != NULL)
-        delete static_cast<VariableSet *>(m_pVariables);
-    if (m_pSections != NULL)
-        delete static_cast<StringSet *>(m_pSections);
-}
-
-int Config::SetSection(const SimpleString &sName)
-{
-    if (!m_bLoaded) {
-        m_bLoaded = true;
-        m_pVariables = new VariableSet();
-        m_pSections = new StringSet();
-        fstream InputFile;
-        bool result;
-        InputFile.open(m_sFileName.c_str(), ios::in);
-        if (InputFile.is_open() == 0) {
-            result = false; 
-        } else {
-            result = preload(InputFile, 
-                *(static_cast<VariableSet *>(m_pVariables)),
-                *(static_cast<StringSet *>(m_pSections)));
-            InputFile.close();
-        }
-        if (!result) {
-            delete static_cast<VariableSet *>(m_pVariables);
-            m_pVariables = NULL;
-            delete static_cast<StringSet *>(m_pSections);
-            m_pSections = NULL;
-            return -1;
-        }
-    }
-    if (m_pVariables == NULL) {
-        return -1;
-    }
-    StringSet::const_iterator i = 
-        ((StringSet*)m_pSections)->find(sName);
-    if (i != ((StringSet*)m_pSections)->end() ) {
-        m_sCurrentSection.assign(sName).append('/');
-        return 0;
-    } else {
-        m_sCurrentSection.resize(0);
-        return -1;
-    }
-}
-
-long Config::GetByNameAsInteger(const SimpleString &sName, long lDefaut) const
-{
-    static SimpleString longName;
-    longName.assign(m_sCurrentSection).append(sName);
-    VariableSet::const_iterator i = 
-        ((VariableSet *)m_pVariables)->find(longName);
-    if (i != ((VariableSet *)m_pVariables)->end()) 
-        return atol((*i).second.c_str());
-    else {
-        return lDefaut;
-    }
-}
-
-const SimpleString &Config::GetByNameAsString(const SimpleString &sName, const SimpleString &sDefaut) const
-{
-    static SimpleString longName;
-    longName.assign(m_sCurrentSection).append(sName);
-    VariableSet::const_iterator i = 
-        ((VariableSet *)m_pVariables)->find(longName);
-    if (i != ((VariableSet *)m_pVariables)->end()) 
-        return (*i).second;
-    else {
-        return sDefaut;
-    }
-}
-
-double Config::GetByNameAsFloat(const SimpleString &sName, double fDefaut) const
-{
-    static SimpleString longName;
-    longName.assign(m_sCurrentSection).append(sName);
-    VariableSet::const_iterator i = 
-        static_cast<VariableSet *>(m_pVariables)->find(longName);
-    if (i != ((VariableSet *)m_pVariables)->end()) 
-        return atof((*i).second.c_str());
-    else {
-        return fDefaut;
-    }
-
-}
-
-bool Config::GetByNameAsBoolean(const SimpleString &sName, bool bDefaut) const
-{
-    static SimpleString longName;
-    longName.assign(m_sCurrentSection).append(sName);
-    VariableSet::const_iterator i = 
-        static_cast<VariableSet *>(m_pVariables)->find(longName);
-    if (i != ((VariableSet *)m_pVariables)->end()) {
-        return (*i).second.compare("true")==0;
-    } else {
-        return bDefaut;
-    }
-}
-
-vecteur Config::GetByNameAsVector(const SimpleString &sName, const vecteur& vDefault) const
-{
-    vecteur tempVecteur;
-    static SimpleString longName; 
-    longName.assign(m_sCurrentSection).append(sName);
-    VariableSet::const_iterator i = 
-        static_cast<VariableSet *>(m_pVariables)->find(longName);
-    if (i != ((VariableSet *)m_pVariables)->end()) {
-        int nbRead = sscanf(i->second.c_str(), "%f,%f,%f", &tempVecteur.x, &tempVecteur.y, &tempVecteur.z);
-        if (nbRead != 3) {
-            return vDefault;
-        }
-        
-        return tempVecteur;
-    } else {
-        return vDefault;
-    }
-}
-
-point Config::GetByNameAsPoint(const SimpleString &sName, const point& ptDefault) const
-{
-    point tempPoint;
-    static SimpleString longName; 
-    longName.assign(m_sCurrentSection).append(sName);
-    VariableSet::const_iterator i = 
-        static_cast<VariableSet *>(m_pVariables)->find(longName);
-    if (i != ((VariableSet *)m_pVariables)->end()) {
-        int nbRead = sscanf(i->second.c_str(), "%f,%f,%f", &tempPoint.x, &tempPoint.y, &tempPoint.z);
-        if (nbRead != 3) {
-            return ptDefault;
-        }
-        
-        return tempPoint;
-    } else {
-        return ptDefault;
-    }
-}
-
-#pragma warning(pop)
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <vector>
+#include "Config.h"
+#include "MappedFile.h"
+
+#pragma warning(push)
+#pragma warning(disable:4996)
+
+// This is a simple config file parser.
+// It does what we need no more no less.
+
+// The file is mapped in memory and parsed in a single pass. Names and values
+// are not copied, they point directly into the mapping. Whitespace and comments
+// inside a token are squeezed out in place, which is why the mapping is private
+// (copy on write) : only the pages that need it are ever copied.
+
+using namespace std;
+
+// Names and values are stored as offsets in the file to keep the records small,
+// a big scene has millions of them.
+struct configSection {
+    unsigned int hash;
+    unsigned int nameOffset;
+    int nameLength;
+    // The variables of a section are stored next to each other
+    int firstEntry, entryCount;
+};
+
+struct configEntry {
+    int section;
+    unsigned int nameOffset;
+    int nameLength;
+    unsigned int valueOffset;
+    int valueLength;
+    // Only built the first time the value is asked as a string
+    int stringIndex;
+};
+
+// Open addressing hash index of the sections and of the (section, name) pairs
+struct configIndex {
+    mappedFile file;
+    vector<configSection> sections;
+    vector<int> sectionTable;
+    vector<configEntry> entries;
+    vector<int> entryTable;
+    // The values asked as strings live in the arena, with their characters.
+    // Nothing has to be freed one by one.
+    SimpleStringArena arena;
+    vector<SimpleString *> strings;
+
+    const char *name(const configSection &section) const { return file.data + section.nameOffset; }
+    const char *name(const configEntry &entry) const { return file.data + entry.nameOffset; }
+    const char *value(const configEntry &entry) const { return file.data + entry.valueOffset; }
+};
+
+static unsigned int hashName(const char *name, int length, unsigned int hash = 2166136261U)
+{
+    for (int i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619U;
+    }
+    // FNV only propagates the bits upward, mix them back into the
+    // low bits since those are the ones selecting the slot.
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+static unsigned int hashEntry(int section, const char *name, int length)
+{
+    return hashName(name, length, 2166136261U ^ (unsigned int)(section * 0x9E3779B9U));
+}
+
+// The tables are kept at most half full, so probing sequences stay short
+static void resizeTable(vector<int> &table, size_t count)
+{
+    size_t tableSize = 16;
+    while (tableSize < 2 * count)
+        tableSize *= 2;
+    table.assign(tableSize, -1);
+}
+
+static int findSection(const configIndex &index, const char *name, int length)
+{
+    unsigned int hash = hashName(name, length);
+    size_t mask = index.sectionTable.size() - 1;
+    for (size_t slot = hash & mask; index.sectionTable[slot] != -1; slot = (slot + 1) & mask)
+    {
+        const configSection &current = index.sections[index.sectionTable[slot]];
+        if (current.hash == hash && current.nameLength == length &&
+            memcmp(index.name(current), name, size_t(length)) == 0)
+            return index.sectionTable[slot];
+    }
+    return -1;
+}
+
+static bool buildSectionTable(configIndex &index)
+{
+    resizeTable(index.sectionTable, index.sections.size());
+    size_t mask = index.sectionTable.size() - 1;
+    for (size_t i = 0; i < index.sections.size(); ++i)
+    {
+        const configSection &current = index.sections[i];
+        size_t slot = current.hash & mask;
+        for (; index.sectionTable[slot] != -1; slot = (slot + 1) & mask)
+        {
+            const configSection &other = index.sections[index.sectionTable[slot]];
+            if (other.hash == current.hash && other.nameLength == current.nameLength &&
+                memcmp(index.name(other), index.name(current), size_t(current.nameLength)) == 0)
+            {
+                // There is already a section by that name !!
+                return false;
+            }
+        }
+        index.sectionTable[slot] = int(i);
+    }
+    return true;
+}
+
+// Sections with fewer variables than this are searched linearly : their
+// entries are contiguous so this avoids touching the hash table at all.
+const int linearSearchLimit = 8;
+
+static const configEntry *findEntry(const configIndex &index, int section, const char *name, int length)
+{
+    const configSection &currentSection = index.sections[section];
+    if (currentSection.entryCount <= linearSearchLimit)
+    {
+        const configEntry *current = &index.entries[0] + currentSection.firstEntry;
+        const configEntry *end = current + currentSection.entryCount;
+        for (; current != end; ++current)
+        {
+            if (current->nameLength == length && memcmp(index.name(*current), name, size_t(length)) == 0)
+                return current;
+        }
+        return NULL;
+    }
+    unsigned int hash = hashEntry(section, name, length);
+    size_t mask = index.entryTable.size() - 1;
+    for (size_t slot = hash & mask; index.entryTable[slot] != -1; slot = (slot + 1) & mask)
+    {
+        const configEntry &current = index.entries[index.entryTable[slot]];
+        if (current.section == section && current.nameLength == length && 
+            memcmp(index.name(current), name, size_t(length)) == 0)
+            return &current;
+    }
+    return NULL;
+}
+
+// Only the variables of the big sections go in the hash table
+static void buildEntryTable(configIndex &index)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < index.sections.size(); ++i)
+    {
+        if (index.sections[i].entryCount > linearSearchLimit)
+            count += size_t(index.sections[i].entryCount);
+    }
+    resizeTable(index.entryTable, count);
+    size_t mask = index.entryTable.size() - 1;
+    for (size_t i = 0; i < index.sections.size(); ++i)
+    {
+        const configSection &currentSection = index.sections[i];
+        if (currentSection.entryCount <= linearSearchLimit)
+            continue;
+        for (int j = currentSection.firstEntry; j < currentSection.firstEntry + currentSection.entryCount; ++j)
+        {
+            const configEntry &current = index.entries[j];
+            size_t slot = hashEntry(current.section, index.name(current), current.nameLength) & mask;
+            bool bDuplicate = false;
+            for (; index.entryTable[slot] != -1; slot = (slot + 1) & mask)
+            {
+                const configEntry &other = index.entries[index.entryTable[slot]];
+                if (other.section == current.section && other.nameLength == current.nameLength && 
+                    memcmp(index.name(other), index.name(current), size_t(current.nameLength)) == 0)
+                {
+                    // Like before, the first definition of a variable wins
+                    bDuplicate = true;
+                    break;
+                }
+            }
+            if (!bDuplicate)
+                index.entryTable[slot] = j;
+        }
+    }
+}
+
+// Classes of characters for the tokenizer, everything else is part of a token
+enum {
+    tokenChar = 0,
+    blankChar,
+    slashChar,
+    openChar,
+    closeChar,
+    equalChar,
+    semicolonChar
+};
+
+struct charClasses {
+    unsigned char classes[256];
+    charClasses() {
+        memset(classes, tokenChar, sizeof(classes));
+        classes[(unsigned char)' '] = classes[(unsigned char)'\t'] = blankChar;
+        classes[(unsigned char)'\n'] = classes[(unsigned char)'\r'] = blankChar;
+        classes[(unsigned char)'/'] = slashChar;
+        classes[(unsigned char)'{'] = openChar;
+        classes[(unsigned char)'}'] = closeChar;
+        classes[(unsigned char)'='] = equalChar;
+        classes[(unsigned char)';'] = semicolonChar;
+    }
+    static const unsigned char *get() { static charClasses instance; return instance.classes; }
+};
+
+static bool preload(char *current, char *end, configIndex &index)
+{
+    const unsigned char *classes = charClasses::get();
+    const char *base = current;
+    // Names and values are stored as 32 bits offsets
+    if (size_t(end - current) > 0xFFFFFFFFU)
+        return false;
+    // Generous estimates, the memory is only really used when we get there
+    index.entries.reserve(size_t(end - current) / 16);
+    index.sections.reserve(size_t(end - current) / 64);
+    enum {
+        findname,
+        insection,
+        variablename,
+        variablevalue
+    } state = findname;
+    int recursion = 0;
+    int currentSection = -1;
+    // The token being read is [tokenStart, tokenEnd). When whitespace or comments
+    // interrupt it, the following characters are moved back to keep it contiguous.
+    char *tokenStart = current;
+    char *tokenEnd = current;
+    const char *name = NULL;
+    int nameLength = 0;
+    
+    while (current != end) {
+        int charClass = classes[(unsigned char)*current];
+        if (charClass == blankChar) {
+            // Get rid of spaces/tabs/newlines. The basic syntax allows us to do that obviously.
+            ++current;
+            continue;
+        }
+        if (charClass == slashChar) {
+            if (current + 1 != end && current[1] == '/') {
+                // Get rid of C-Style comments 
+                while (current != end && *current != '\n')
+                    ++current;
+                continue;
+            }
+            charClass = tokenChar;
+        }
+
+        switch (state) {
+        case findname:
+            if (charClass == openChar) {
+                configSection section = {hashName(tokenStart, int(tokenEnd - tokenStart)), 
+                                         (unsigned int)(tokenStart - base), int(tokenEnd - tokenStart), 
+                                         int(index.entries.size()), 0};
+                index.sections.push_back(section);
+                currentSection = int(index.sections.size()) - 1;
+                tokenStart = tokenEnd;
+                recursion = 0;
+                state = insection;
+                // The brace is handled in the section
+                continue;
+            }
+            charClass = tokenChar;
+            break;
+        case insection:
+            if (charClass == openChar) {
+                ++recursion;
+                ++current;
+                continue;
+            } else if (charClass == closeChar) {
+                --recursion;
+                if (recursion == 0) {
+                    // We finished extracting the variables of the section
+                    currentSection = -1;
+                    state = findname;
+                }
+                ++current;
+                continue;
+            }
+            state = variablename;
+            charClass = tokenChar;
+            break;
+        case variablename:
+            if (charClass == openChar) {
+                // It was not a variable but the start of a new block
+                state = insection;
+                continue;
+            } else if (charClass == closeChar) {
+                return false;
+            } else if (charClass == equalChar) {
+                if (tokenEnd == tokenStart)
+                    return false;
+                name = tokenStart;
+                nameLength = int(tokenEnd - tokenStart);
+                tokenStart = tokenEnd;
+                state = variablevalue;
+                ++current;
+                continue;
+            }
+            charClass = tokenChar;
+            break;
+        case variablevalue:
+            if (charClass == openChar || charClass == closeChar) {
+                return false;
+            } else if (charClass == semicolonChar) {
+                if (tokenEnd == tokenStart)
+                    return false;
+                // We store the variable with the index of its section
+                configEntry entry = {currentSection, (unsigned int)(name - base), nameLength, 
+                                     (unsigned int)(tokenStart - base), int(tokenEnd - tokenStart), -1};
+                index.entries.push_back(entry);
+                index.sections[currentSection].entryCount++;
+                tokenStart = tokenEnd;
+                state = insection;
+                ++current;
+                continue;
+            }
+            charClass = tokenChar;
+            break;
+        }
+
+        // Append the current character and all the ordinary ones that follow to the token.
+        // Most of the time the token is still in place and there is nothing to copy.
+        if (tokenStart == tokenEnd) {
+            tokenStart = tokenEnd = current;
+        }
+        if (tokenEnd == current) {
+            do {
+                ++current;
+            } while (current != end && classes[(unsigned char)*current] == tokenChar);
+            tokenEnd = current;
+        } else {
+            do {
+                *tokenEnd++ = *current++;
+            } while (current != end && classes[(unsigned char)*current] == tokenChar);
+        }
+    }
+    if (state != findname)
+        return false;
+    // The tables are only built once everything is read, so that they have their final size
+    if (!buildSectionTable(index))
+        return false;
+    buildEntryTable(index);
+    return true;
+}
+
+// Numbers are parsed directly from the mapping. Simple decimal numbers
+// are converted exactly (a mantissa that fits in a double scaled by an
+// exact power of ten) and anything more exotic goes through strtod.
+static const double exactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const char *parseNumber(const char *current, const char *end, double &result)
+{
+    const char *start = current;
+    bool bNegative = false;
+    if (current != end && (*current == '-' || *current == '+')) {
+        bNegative = (*current == '-');
+        ++current;
+    }
+    unsigned long long mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool bExact = true;
+    for (; current != end && *current >= '0' && *current <= '9'; ++current, ++digits) {
+        mantissa = mantissa * 10 + (*current - '0');
+    }
+    if (current != end && *current == '.') {
+        for (++current; current != end && *current >= '0' && *current <= '9'; ++current, ++digits) {
+            mantissa = mantissa * 10 + (*current - '0');
+            --exponent;
+        }
+    }
+    if (digits == 0 || (current != end && (*current == 'x' || *current == 'X')))
+        bExact = false;
+    if (bExact && current != end && (*current == 'e' || *current == 'E')) {
+        const char *exponentStart = current++;
+        bool bNegativeExponent = false;
+        if (current != end && (*current == '-' || *current == '+')) {
+            bNegativeExponent = (*current == '-');
+            ++current;
+        }
+        if (current == end || *current < '0' || *current > '9') {
+            // Not an exponent after all
+            current = exponentStart;
+        } else {
+            int value = 0;
+            for (; current != end && *current >= '0' && *current <= '9'; ++current)
+                value = (value < 1000) ? value * 10 + (*current - '0') : value;
+            exponent += bNegativeExponent ? -value : value;
+        }
+    }
+    if (digits > 15 || exponent < -22 || exponent > 22)
+        bExact = false;
+    if (bExact) {
+        result = double(mantissa);
+        result = (exponent < 0) ? result / exactPowersOfTen[-exponent] : result * exactPowersOfTen[exponent];
+        if (bNegative)
+            result = -result;
+        return current;
+    }
+    // Slow path : hexadecimal, infinities, very long numbers..
+    char buf[64];
+    size_t length = min(size_t(end - start), sizeof(buf) - 1);
+    memcpy(buf, start, length);
+    buf[length] = '\0';
+    char *stop;
+    result = strtod(buf, &stop);
+    return start + (stop - buf);
+}
+
+static bool parseTriple(const char *current, const char *end, float &x, float &y, float &z)
+{
+    double value[3];
+    for (int i = 0; i < 3; ++i) {
+        if (i > 0) {
+            if (current == end || *current != ',')
+                return false;
+            ++current;
+        }
+        const char *next = parseNumber(current, end, value[i]);
+        if (next == current)
+            return false;
+        current = next;
+    }
+    x = float(value[0]);
+    y = float(value[1]);
+    z = float(value[2]);
+    return true;
+}
+
+static const configEntry *lookup(void *pIndex, int section, const SimpleString &sName)
+{
+    if (pIndex == NULL || section == -1)
+        return NULL;
+    return findEntry(*static_cast<configIndex *>(pIndex), section, sName.c_str(), sName.size());
+}
+
+Config::Config(const SimpleString &sFileName) :
+m_pIndex(NULL),
+m_sFileName(sFileName),
+m_iCurrentSection(-1),
+m_bLoaded(false)
+{
+}
+
+Config::Config(const char *pData, size_t size) :
+m_pIndex(NULL),
+m_sFileName(""),
+m_iCurrentSection(-1),
+m_bLoaded(true)
+{
+    configIndex *pIndex = new configIndex();
+    pIndex->file.Copy(pData, size);
+    if (!preload(pIndex->file.privateData(), pIndex->file.privateData() + pIndex->file.size, *pIndex)) {
+        delete pIndex;
+        return;
+    }
+    m_pIndex = pIndex;
+}
+
+Config::~Config()
+{
+    if (m_pIndex != NULL)
+        delete static_cast<configIndex *>(m_pIndex);
+}
+
+int Config::SetSection(const SimpleString &sName)
+{
+    if (!m_bLoaded) {
+        m_bLoaded = true;
+        configIndex *pIndex = new configIndex();
+        bool result = pIndex->file.Open(m_sFileName.c_str(), true);
+        if (result) {
+            result = preload(pIndex->file.privateData(), 
+                pIndex->file.privateData() + pIndex->file.size, *pIndex);
+        }
+        if (!result) {
+            delete pIndex;
+            return -1;
+        }
+        m_pIndex = pIndex;
+    }
+    if (m_pIndex == NULL) {
+        return -1;
+    }
+    m_iCurrentSection = findSection(*static_cast<configIndex *>(m_pIndex), sName.c_str(), sName.size());
+    return (m_iCurrentSection != -1) ? 0 : -1;
+}
+
+int Config::GetEntryCount() const
+{
+    if (m_pIndex == NULL || m_iCurrentSection == -1)
+        return 0;
+    return static_cast<configIndex *>(m_pIndex)->sections[m_iCurrentSection].entryCount;
+}
+
+SimpleString Config::GetEntryName(int iEntry) const
+{
+    const configIndex &index = *static_cast<configIndex *>(m_pIndex);
+    const configEntry &entry = index.entries[index.sections[m_iCurrentSection].firstEntry + iEntry];
+    return SimpleString(index.name(entry), entry.nameLength);
+}
+
+long Config::GetByNameAsInteger(const SimpleString &sName, long lDefaut) const
+{
+    const configEntry *pEntry = lookup(m_pIndex, m_iCurrentSection, sName);
+    if (pEntry == NULL)
+        return lDefaut;
+    // Same as atol : optional sign, then as many digits as we can find
+    const char *current = static_cast<configIndex *>(m_pIndex)->value(*pEntry);
+    const char *end = current + pEntry->valueLength;
+    bool bNegative = false;
+    if (current != end && (*current == '-' || *current == '+')) {
+        bNegative = (*current == '-');
+        ++current;
+    }
+    long result = 0;
+    for (; current != end && *current >= '0' && *current <= '9'; ++current)
+        result = result * 10 + (*current - '0');
+    return bNegative ? -result : result;
+}
+
+const SimpleString &Config::GetByNameAsString(const SimpleString &sName, const SimpleString &sDefaut) const
+{
+    const configEntry *pEntry = lookup(m_pIndex, m_iCurrentSection, sName);
+    if (pEntry == NULL)
+        return sDefaut;
+    configIndex &index = *static_cast<configIndex *>(m_pIndex);
+    configEntry &entry = const_cast<configEntry &>(*pEntry);
+    if (entry.stringIndex == -1) {
+        entry.stringIndex = int(index.strings.size());
+        void *pString = index.arena.allocate(sizeof(SimpleString));
+        index.strings.push_back(new (pString) SimpleString(index.value(entry), entry.valueLength, &index.arena));
+    }
+    return *index.strings[entry.stringIndex];
+}
+
+double Config::GetByNameAsFloat(const SimpleString &sName, double fDefaut) const
+{
+    const configEntry *pEntry = lookup(m_pIndex, m_iCurrentSection, sName);
+    if (pEntry == NULL)
+        return fDefaut;
+    const char *value = static_cast<configIndex *>(m_pIndex)->value(*pEntry);
+    double result;
+    if (parseNumber(value, value + pEntry->valueLength, result) == value)
+        return 0.0;
+    return result;
+}
+
+bool Config::GetByNameAsBoolean(const SimpleString &sName, bool bDefaut) const
+{
+    const configEntry *pEntry = lookup(m_pIndex, m_iCurrentSection, sName);
+    if (pEntry == NULL)
+        return bDefaut;
+    return pEntry->valueLength == 4 && 
+        memcmp(static_cast<configIndex *>(m_pIndex)->value(*pEntry), "true", 4) == 0;
+}
+
+vecteur Config::GetByNameAsVector(const SimpleString &sName, const vecteur& vDefault) const
+{
+    vecteur tempVecteur;
+    const configEntry *pEntry = lookup(m_pIndex, m_iCurrentSection, sName);
+    if (pEntry == NULL)
+        return vDefault;
+    const char *value = static_cast<configIndex *>(m_pIndex)->value(*pEntry);
+    if (!parseTriple(value, value + pEntry->valueLength, tempVecteur.x, tempVecteur.y, tempVecteur.z))
+        return vDefault;
+    return tempVecteur;
+}
+
+point Config::GetByNameAsPoint(const SimpleString &sName, const point& ptDefault) const
+{
+    point tempPoint;
+    const configEntry *pEntry = lookup(m_pIndex, m_iCurrentSection, sName);
+    if (pEntry == NULL)
+        return ptDefault;
+    const char *value = static_cast<configIndex *>(m_pIndex)->value(*pEntry);
+    if (!parseTriple(value, value + pEntry->valueLength, tempPoint.x, tempPoint.y, tempPoint.z))
+        return ptDefault;
+    return tempPoint;
+}
+
+#pragma warning(pop)
@@ -1,188 +1,238 @@
-/*
-    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
-    It is free to use for educational purpose and cannot be redistributed
-    outside of the tutorial pages.
-    Any further inquiry :
-    mailto:info@codermind.com
- */
-
-#include "Cubemap.h"
-#include "Texture.h"
-#include <cmath>
-#include <fstream>
-
-using namespace std;
-
-bool dummyTGAHeader(ifstream &currentfile, int &sizeX, int &sizeY)
-{
-	char dummy;
-	char temp;
-	currentfile.get(dummy).get(dummy);
-	currentfile.get(temp);                  /* uncompressed RGB */
-	if (temp!=2)
-		return false;
-	currentfile.get(dummy).get(dummy);
-	currentfile.get(dummy).get(dummy);
-	currentfile.get(dummy);
-	currentfile.get(dummy).get(dummy);           /* origin X */
-	currentfile.get(dummy).get(dummy);           /* origin Y */
-	currentfile.get(temp);
-	sizeX = temp;
-	currentfile.get(temp);
-	sizeX += temp * 256;
-
-	currentfile.get(temp);
-	sizeY = temp;
-	currentfile.get(temp);
-	sizeY += temp * 256;
-
-    currentfile.get(temp);                 /* 24 bit bitmap */
-	currentfile.get(dummy);
-	return true;
-}
-
-bool cubemap::Init()
-{
-    if (texture)
-    {
-        return false;
-    }
-    ifstream currentfile ;
-    color * currentColor;
-    int x,y, dummySizeX, dummySizeY;
-
-    currentfile.open(name[up].c_str(), ios_base::binary);
-    if ((!currentfile)||(!dummyTGAHeader(currentfile, sizeX, sizeY)))
-        return false;
-    if (sizeX <= 0 || sizeY <= 0)
-        return false;
-    texture = new color[size_t(sizeX * sizeY * 6)];
-
-    int number = cubemap::up * sizeX * sizeY;
-    currentColor = 	texture + number;
-    for (y = 0; y < sizeY; y++)
-    for (x = 0; x < sizeX; x++)
-    {
-        currentColor->blue = currentfile.get() /255.0f;
-        currentColor->green = currentfile.get() /255.0f;
-        currentColor->red = currentfile.get() /255.0f;
-        currentColor++;
-    }
-    currentfile.close();
-	
-    for (unsigned i = cubemap::down; i <= cubemap::backward; ++i)
-    {
-        number = i * sizeX * sizeY;
-        currentColor = 	texture + number;
-        currentfile.open(name[i].c_str(), ios_base::binary);
-        if ((!currentfile)||
-            (!dummyTGAHeader(currentfile, dummySizeX, dummySizeY)) ||
-            sizeX != dummySizeX || 
-            sizeY != dummySizeY)
-        {
-            // The textures for each face have to be of the same size..
-            delete [] texture;
-            texture = 0;
-            return false;
-        }
-
-        for (y = 0; y < sizeY; y++)
-        for (x = 0; x < sizeX; x++)
-        {
-            currentColor->blue = currentfile.get() /255.0f;
-            currentColor->green = currentfile.get() /255.0f;
-            currentColor->red = currentfile.get() /255.0f;
-            currentColor++;
-        }
-        currentfile.close();
-    }
-
-    return true;
-}
-
-color readCubemap(const cubemap & cm, const ray &myRay)
-{
-    color * currentColor ;
-    color outputColor = {0.0f,0.0f,0.0f};
-    if(!cm.texture)
-    {
-        return outputColor;
-    }
-    if ((fabsf(myRay.dir.x) >= fabsf(myRay.dir.y)) && (fabsf(myRay.dir.x) >= fabsf(myRay.dir.z)))
-    {
-        if (myRay.dir.x > 0.0f)
-        {
-            currentColor = cm.texture + cubemap::right * cm.sizeX * cm.sizeY;
-            outputColor = readTexture(currentColor,  
-                1.0f - (myRay.dir.z / myRay.dir.x+ 1.0f) * 0.5f,  
-                (myRay.dir.y / myRay.dir.x+ 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
-        }
-        else if (myRay.dir.x < 0.0f)
-        {
-            currentColor = cm.texture + cubemap::left * cm.sizeX * cm.sizeY;
-            outputColor = readTexture(currentColor,  
-                1.0f - (myRay.dir.z / myRay.dir.x+ 1.0f) * 0.5f,
-                1.0f - ( myRay.dir.y / myRay.dir.x + 1.0f) * 0.5f,  
-                cm.sizeX, cm.sizeY);
-        }
-    }
-    else if ((fabsf(myRay.dir.y) >= fabsf(myRay.dir.x)) && (fabsf(myRay.dir.y) >= fabsf(myRay.dir.z)))
-    {
-        if (myRay.dir.y > 0.0f)
-        {
-            currentColor = cm.texture + cubemap::up * cm.sizeX * cm.sizeY;
-            outputColor = readTexture(currentColor,  
-                (myRay.dir.x / myRay.dir.y + 1.0f) * 0.5f,
-                1.0f - (myRay.dir.z/ myRay.dir.y + 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
-        }
-        else if (myRay.dir.y < 0.0f)
-        {
-            currentColor = cm.texture + cubemap::down * cm.sizeX * cm.sizeY;
-            outputColor = readTexture(currentColor,  
-                1.0f - (myRay.dir.x / myRay.dir.y + 1.0f) * 0.5f,  
-                (myRay.dir.z/myRay.dir.y + 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
-        }
-    }
-    else if ((fabsf(myRay.dir.z) >= fabsf(myRay.dir.x)) && (fabsf(myRay.dir.z) >= fabsf(myRay.dir.y)))
-    {
-        if (myRay.dir.z > 0.0f)
-        {
-            currentColor = cm.texture + cubemap::forward * cm.sizeX * cm.sizeY;
-            outputColor = readTexture(currentColor,  
-                (myRay.dir.x / myRay.dir.z + 1.0f) * 0.5f,  
-                (myRay.dir.y/myRay.dir.z + 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
-        }
-        else if (myRay.dir.z < 0.0f)
-        {
-            currentColor = cm.texture + cubemap::backward * cm.sizeX * cm.sizeY;
-            outputColor = readTexture(currentColor,  
-                (myRay.dir.x / myRay.dir.z + 1.0f) * 0.5f,  
-                1.0f - (myRay.dir.y /myRay.dir.z+1) * 0.5f, cm.sizeX, cm.sizeY);
-        }
-    }
-    if (cm.bsRGB)
-    {
-       // We make sure the data that was in sRGB storage mode is brought back to a 
-       // linear format. We don't need the full accuracy of the sRGBEncode function
-       // so a powf should be sufficient enough.
-       outputColor.blue   = powf(outputColor.blue, 2.2f);
-       outputColor.red    = powf(outputColor.red, 2.2f);
-       outputColor.green  = powf(outputColor.green, 2.2f);
-    }
-
-    if (cm.bExposed)
-    {
-        // The LDR (low dynamic range) images were supposedly already
-        // exposed, but we need to make the inverse transformation
-        // so that we can expose them a second time.
-        outputColor.blue  = -logf(1.001f - outputColor.blue);
-        outputColor.red   = -logf(1.001f - outputColor.red);
-        outputColor.green = -logf(1.001f - outputColor.green);
-    }
-
-    outputColor.blue  /= cm.exposure;
-    outputColor.red   /= cm.exposure;
-    outputColor.green /= cm.exposure;
-
-    return outputColor;
-}
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "Cubemap.h"
+#include "Texture.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <chrono>
+
+using namespace std;
+
+// Version of the binary cache layout, bump it whenever the layout or
+// the conversion of the texels changes.
+#define CUBEMAP_CACHE_VERSION 1
+
+// The cache is a header followed by the six faces, already converted
+// to linear floats. The header is padded so that the texels are aligned.
+struct cubemapCacheHeader
+{
+    char magic[8];
+    unsigned int version;
+    int sizeX, sizeY;
+    unsigned int flags;
+    unsigned long long sourceHash[6];
+    char padding[128 - 8 - 4 * 4 - 6 * 8];
+};
+
+static const char cubemapCacheMagic[8] = {'R','T','4','C','U','B','E','\0'};
+
+enum {
+    cacheFlagExposed = 1,
+    cacheFlagsRGB = 2
+};
+
+static bool dummyTGAHeader(const mappedFile &currentfile, int &sizeX, int &sizeY)
+{
+    const unsigned char *header = reinterpret_cast<const unsigned char *>(currentfile.data);
+    if (currentfile.size < 18)
+        return false;
+    if (header[2] != 2)                 /* uncompressed RGB */
+        return false;
+    sizeX = header[12] + header[13] * 256;
+    sizeY = header[14] + header[15] * 256;
+    if (header[16] != 24)               /* 24 bit bitmap */
+        return false;
+    return currentfile.size >= 18 + size_t(sizeX) * size_t(sizeY) * 3;
+}
+
+// Bring a texel back to a linear format, so that we don't have to do it
+// every time we read the cubemap.
+static float linearize(float c, bool bsRGB, bool bExposed)
+{
+    if (bsRGB)
+    {
+        // We make sure the data that was in sRGB storage mode is brought back to a 
+        // linear format. We don't need the full accuracy of the sRGBEncode function
+        // so a powf should be sufficient enough.
+        c = powf(c, 2.2f);
+    }
+    if (bExposed)
+    {
+        // The LDR (low dynamic range) images were supposedly already
+        // exposed, but we need to make the inverse transformation
+        // so that we can expose them a second time.
+        c = -logf(1.001f - c);
+    }
+    return c;
+}
+
+bool cubemap::Init()
+{
+    if (texture)
+    {
+        return false;
+    }
+    mappedFile faces[6];
+    cubemapCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cubemapCacheMagic, sizeof(header.magic));
+    header.version = CUBEMAP_CACHE_VERSION;
+    header.flags = (bExposed ? cacheFlagExposed : 0) | (bsRGB ? cacheFlagsRGB : 0);
+
+    for (unsigned i = cubemap::up; i <= cubemap::backward; ++i)
+    {
+        int dummySizeX, dummySizeY;
+        if (!faces[i].Open(name[i].c_str()) || 
+            !dummyTGAHeader(faces[i], dummySizeX, dummySizeY))
+            return false;
+        if (i == cubemap::up)
+        {
+            sizeX = dummySizeX;
+            sizeY = dummySizeY;
+            if (sizeX <= 0 || sizeY <= 0)
+                return false;
+        }
+        else if (sizeX != dummySizeX || sizeY != dummySizeY)
+        {
+            // The textures for each face have to be of the same size..
+            return false;
+        }
+        header.sourceHash[i] = hashBytes(faces[i].data, faces[i].size);
+    }
+    header.sizeX = sizeX;
+    header.sizeY = sizeY;
+
+    const size_t textureSize = size_t(sizeX) * size_t(sizeY) * 6 * sizeof(color);
+    SimpleString cacheName(name[up]);
+    cacheName.append(".rt4cache");
+
+    // If a cache matching the sources and settings exists, we use it in place
+    if (cache.Open(cacheName.c_str()))
+    {
+        if (cache.size == sizeof(header) + textureSize &&
+            memcmp(cache.data, &header, sizeof(header)) == 0)
+        {
+            texture = reinterpret_cast<color *>(const_cast<char *>(cache.data) + sizeof(header));
+            return true;
+        }
+        cache.Close();
+    }
+
+    texture = new color[size_t(sizeX) * size_t(sizeY) * 6];
+    for (unsigned i = cubemap::up; i <= cubemap::backward; ++i)
+    {
+        const unsigned char *currentTexel = reinterpret_cast<const unsigned char *>(faces[i].data) + 18;
+        color *currentColor = texture + i * sizeX * sizeY;
+        for (int n = sizeX * sizeY; n > 0; --n)
+        {
+            currentColor->blue = linearize(currentTexel[0] / 255.0f, bsRGB, bExposed);
+            currentColor->green = linearize(currentTexel[1] / 255.0f, bsRGB, bExposed);
+            currentColor->red = linearize(currentTexel[2] / 255.0f, bsRGB, bExposed);
+            currentTexel += 3;
+            currentColor++;
+        }
+    }
+
+    // Write the cache for the next run. It is written under a temporary name
+    // then renamed so that concurrent runs never see a partial file.
+    // The thread and the time make the name unique, scenes can be loaded
+    // from several threads of a process at once.
+    // Failing to write it (read only directory..) is not an error.
+    SimpleString tempName(cacheName);
+    tempName.append(".tmp");
+    tempName.append((unsigned long)(hash<thread::id>()(this_thread::get_id()) ^ 
+                                    (size_t)chrono::steady_clock::now().time_since_epoch().count()));
+    {
+        ofstream cacheFile(tempName.c_str(), ios_base::binary);
+        if (cacheFile)
+        {
+            cacheFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            cacheFile.write(reinterpret_cast<const char *>(texture), streamsize(textureSize));
+        }
+        if (!cacheFile)
+        {
+            cacheFile.close();
+            remove(tempName.c_str());
+            return true;
+        }
+    }
+    rename(tempName.c_str(), cacheName.c_str());
+
+    return true;
+}
+
+color readCubemap(const cubemap & cm, const ray &myRay)
+{
+    color * currentColor ;
+    color outputColor = {0.0f,0.0f,0.0f};
+    if(!cm.texture)
+    {
+        return outputColor;
+    }
+    if ((fabsf(myRay.dir.x) >= fabsf(myRay.dir.y)) && (fabsf(myRay.dir.x) >= fabsf(myRay.dir.z)))
+    {
+        if (myRay.dir.x > 0.0f)
+        {
+            currentColor = cm.texture + cubemap::right * cm.sizeX * cm.sizeY;
+            outputColor = readTexture(currentColor,  
+                1.0f - (myRay.dir.z / myRay.dir.x+ 1.0f) * 0.5f,  
+                (myRay.dir.y / myRay.dir.x+ 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
+        }
+        else if (myRay.dir.x < 0.0f)
+        {
+            currentColor = cm.texture + cubemap::left * cm.sizeX * cm.sizeY;
+            outputColor = readTexture(currentColor,  
+                1.0f - (myRay.dir.z / myRay.dir.x+ 1.0f) * 0.5f,
+                1.0f - ( myRay.dir.y / myRay.dir.x + 1.0f) * 0.5f,  
+                cm.sizeX, cm.sizeY);
+        }
+    }
+    else if ((fabsf(myRay.dir.y) >= fabsf(myRay.dir.x)) && (fabsf(myRay.dir.y) >= fabsf(myRay.dir.z)))
+    {
+        if (myRay.dir.y > 0.0f)
+        {
+            currentColor = cm.texture + cubemap::up * cm.sizeX * cm.sizeY;
+            outputColor = readTexture(currentColor,  
+                (myRay.dir.x / myRay.dir.y + 1.0f) * 0.5f,
+                1.0f - (myRay.dir.z/ myRay.dir.y + 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
+        }
+        else if (myRay.dir.y < 0.0f)
+        {
+            currentColor = cm.texture + cubemap::down * cm.sizeX * cm.sizeY;
+            outputColor = readTexture(currentColor,  
+                1.0f - (myRay.dir.x / myRay.dir.y + 1.0f) * 0.5f,  
+                (myRay.dir.z/myRay.dir.y + 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
+        }
+    }
+    else if ((fabsf(myRay.dir.z) >= fabsf(myRay.dir.x)) && (fabsf(myRay.dir.z) >= fabsf(myRay.dir.y)))
+    {
+        if (myRay.dir.z > 0.0f)
+        {
+            currentColor = cm.texture + cubemap::forward * cm.sizeX * cm.sizeY;
+            outputColor = readTexture(currentColor,  
+                (myRay.dir.x / myRay.dir.z + 1.0f) * 0.5f,  
+                (myRay.dir.y/myRay.dir.z + 1.0f) * 0.5f, cm.sizeX, cm.sizeY);
+        }
+        else if (myRay.dir.z < 0.0f)
+        {
+            currentColor = cm.texture + cubemap::backward * cm.sizeX * cm.sizeY;
+            outputColor = readTexture(currentColor,  
+                (myRay.dir.x / myRay.dir.z + 1.0f) * 0.5f,  
+                1.0f - (myRay.dir.y /myRay.dir.z+1) * 0.5f, cm.sizeX, cm.sizeY);
+        }
+    }
+    outputColor.blue  /= cm.exposure;
+    outputColor.red   /= cm.exposure;
+    outputColor.green /= cm.exposure;
+
+    return outputColor;
+}
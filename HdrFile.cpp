@@ -0,0 +1,378 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstddef>
+#include <cmath>
+using namespace std;
+
+#include "HdrFile.h"
+#include "MappedFile.h"
+
+// Files go row by row, the image keeps the fragments of a pixel together.
+// Fragment rows and columns start at the bottom left like our TGA files.
+static color &fragmentAt(const hdrImage &image, int fx, int fy)
+{
+    size_t pixel = size_t(fy / 2) * image.width + fx / 2;
+    return image.fragments[4 * pixel + 2 * (fx & 1) + (fy & 1)];
+}
+
+static bool hasExtension(const char *fileName, const char *extension)
+{
+    size_t length = strlen(fileName), extensionLength = strlen(extension);
+    return length >= extensionLength && strcmp(fileName + length - extensionLength, extension) == 0;
+}
+
+// Color PFM, a negative scale means little endian.
+// Rows go from the bottom to the top.
+static bool writePfm(const char *fileName, const hdrImage &image)
+{
+    ofstream imageFile(fileName, ios_base::binary);
+    if (!imageFile)
+        return false;
+    int width = 2 * image.width, height = 2 * image.height;
+    imageFile << "PF\n" << width << " " << height << "\n-1.0\n";
+    vector<float> row(3 * size_t(width));
+    for (int fy = 0; fy < height; ++fy)
+    {
+        for (int fx = 0; fx < width; ++fx)
+        {
+            const color &fragment = fragmentAt(image, fx, fy);
+            row[3 * fx] = fragment.red;
+            row[3 * fx + 1] = fragment.green;
+            row[3 * fx + 2] = fragment.blue;
+        }
+        imageFile.write((const char *)&row[0], row.size() * sizeof(float));
+    }
+    return bool(imageFile);
+}
+
+// OpenEXR attributes are a name, a type, a size and the value
+static void writeAttribute(ofstream &imageFile, const char *name, const char *type, const void *value, int size)
+{
+    imageFile.write(name, strlen(name) + 1);
+    imageFile.write(type, strlen(type) + 1);
+    imageFile.write((const char *)&size, sizeof(size));
+    imageFile.write((const char *)value, size);
+}
+
+enum {
+    exrMagic = 20000630,
+    exrVersion = 2,
+    // Version flags of the files we can't read
+    exrTiled = 0x200,
+    exrMultiPart = 0x1000,
+    exrUint = 0,
+    exrHalf = 1,
+    exrFloat = 2
+};
+
+// Single part scan line file, one line per chunk and no compression.
+// Channels are stored in alphabetical order : B, G then R.
+// Lines go from the top to the bottom.
+static bool writeExr(const char *fileName, const hdrImage &image)
+{
+    ofstream imageFile(fileName, ios_base::binary);
+    if (!imageFile)
+        return false;
+    int width = 2 * image.width, height = 2 * image.height;
+    int header[2] = {exrMagic, exrVersion};
+    imageFile.write((const char *)header, sizeof(header));
+
+    char channels[3 * 18 + 1];
+    memset(channels, 0, sizeof(channels));
+    const char channelNames[3] = {'B', 'G', 'R'};
+    for (int i = 0; i < 3; ++i)
+    {
+        // name, pixel type, linear flag and reserved bytes, sampling
+        char *channel = channels + 18 * i;
+        int description[4] = {exrFloat, 0, 1, 1};
+        channel[0] = channelNames[i];
+        memcpy(channel + 2, description, sizeof(description));
+    }
+    writeAttribute(imageFile, "channels", "chlist", channels, sizeof(channels));
+    char noCompression = 0, increasingY = 0;
+    writeAttribute(imageFile, "compression", "compression", &noCompression, 1);
+    int window[4] = {0, 0, width - 1, height - 1};
+    writeAttribute(imageFile, "dataWindow", "box2i", window, sizeof(window));
+    writeAttribute(imageFile, "displayWindow", "box2i", window, sizeof(window));
+    writeAttribute(imageFile, "lineOrder", "lineOrder", &increasingY, 1);
+    float one = 1.0f, center[2] = {0.0f, 0.0f};
+    writeAttribute(imageFile, "pixelAspectRatio", "float", &one, sizeof(one));
+    writeAttribute(imageFile, "screenWindowCenter", "v2f", center, sizeof(center));
+    writeAttribute(imageFile, "screenWindowWidth", "float", &one, sizeof(one));
+    imageFile.put(0);
+
+    // Offsets of the chunks from the start of the file
+    int lineSize = 3 * width * int(sizeof(float));
+    unsigned long long offset = (unsigned long long)imageFile.tellp() + height * sizeof(offset);
+    for (int y = 0; y < height; ++y, offset += 2 * sizeof(int) + lineSize)
+    {
+        imageFile.write((const char *)&offset, sizeof(offset));
+    }
+    vector<float> line(3 * size_t(width));
+    for (int y = 0; y < height; ++y)
+    {
+        int fy = height - 1 - y;
+        for (int fx = 0; fx < width; ++fx)
+        {
+            const color &fragment = fragmentAt(image, fx, fy);
+            line[fx] = fragment.blue;
+            line[width + fx] = fragment.green;
+            line[2 * width + fx] = fragment.red;
+        }
+        int chunk[2] = {y, lineSize};
+        imageFile.write((const char *)chunk, sizeof(chunk));
+        imageFile.write((const char *)&line[0], lineSize);
+    }
+    return bool(imageFile);
+}
+
+bool writeHdrImage(const char *fileName, const hdrImage &image)
+{
+    if (hasExtension(fileName, ".exr"))
+        return writeExr(fileName, image);
+    return writePfm(fileName, image);
+}
+
+// The fragments are grouped by pixel, the files must have whole pixels
+static bool allocateImage(int width, int height, hdrImage &image, vector<color> &fragments)
+{
+    if (width <= 0 || height <= 0 || (width & 1) || (height & 1))
+    {
+        cout << "Mal formed HDR file : the size must be a positive even number." << endl;
+        return false;
+    }
+    image.width = width / 2;
+    image.height = height / 2;
+    color black = {0.0f, 0.0f, 0.0f};
+    fragments.assign(size_t(width) * height, black);
+    image.fragments = &fragments[0];
+    return true;
+}
+
+static float swapFloat(float value)
+{
+    unsigned char bytes[4], swapped[4];
+    memcpy(bytes, &value, 4);
+    for (int i = 0; i < 4; ++i)
+        swapped[i] = bytes[3 - i];
+    memcpy(&value, swapped, 4);
+    return value;
+}
+
+static bool readPfm(const mappedFile &imageFile, hdrImage &image, vector<color> &fragments)
+{
+    // The header is three lines of text : PF, the size and the scale
+    char header[64];
+    size_t headerSize = 0;
+    for (int lines = 0; lines < 3; ++headerSize)
+    {
+        if (headerSize >= imageFile.size || headerSize >= sizeof(header) - 1)
+            return false;
+        header[headerSize] = imageFile.data[headerSize];
+        if (header[headerSize] == '\n')
+            ++lines;
+    }
+    header[headerSize] = 0;
+    int width, height;
+    float scale;
+    if (sscanf(header, "PF %d %d %f", &width, &height, &scale) != 3)
+        return false;
+    if (!allocateImage(width, height, image, fragments))
+        return false;
+    if (imageFile.size < headerSize + fragments.size() * 3 * sizeof(float))
+        return false;
+    const char *data = imageFile.data + headerSize;
+    for (int fy = 0; fy < height; ++fy)
+    {
+        for (int fx = 0; fx < width; ++fx, data += 3 * sizeof(float))
+        {
+            float rgb[3];
+            memcpy(rgb, data, sizeof(rgb));
+            if (scale > 0.0f)
+            {
+                // Big endian file
+                for (int i = 0; i < 3; ++i)
+                    rgb[i] = swapFloat(rgb[i]);
+            }
+            color &fragment = fragmentAt(image, fx, fy);
+            fragment.red = rgb[0];
+            fragment.green = rgb[1];
+            fragment.blue = rgb[2];
+        }
+    }
+    return true;
+}
+
+static float halfToFloat(unsigned short half)
+{
+    int sign = half >> 15, exponent = (half >> 10) & 31, mantissa = half & 1023;
+    float value;
+    if (exponent == 0)
+        value = ldexpf(float(mantissa), -24);
+    else if (exponent == 31)
+        value = mantissa ? NAN : INFINITY;
+    else
+        value = ldexpf(float(mantissa + 1024), exponent - 25);
+    return sign ? -value : value;
+}
+
+// Reads a little endian value and moves past it
+template <class T> static bool readValue(const char *&data, const char *end, T &value)
+{
+    if (end - data < ptrdiff_t(sizeof(T)))
+        return false;
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+static bool readString(const char *&data, const char *end, const char *&value)
+{
+    const char *stringEnd = (const char *)memchr(data, 0, end - data);
+    if (!stringEnd)
+        return false;
+    value = data;
+    data = stringEnd + 1;
+    return true;
+}
+
+static bool readExr(const mappedFile &imageFile, hdrImage &image, vector<color> &fragments)
+{
+    const char *data = imageFile.data, *end = imageFile.data + imageFile.size;
+    int magic, version;
+    if (!readValue(data, end, magic) || !readValue(data, end, version) || magic != exrMagic)
+        return false;
+    if ((version & 255) != exrVersion || (version & (exrTiled | exrMultiPart)))
+    {
+        cout << "Mal formed HDR file : only scan line OpenEXR files can be read." << endl;
+        return false;
+    }
+
+    // Byte offset of each channel in a line, as a fraction of the width
+    int channelOffset[3] = {-1, -1, -1}, channelType[3] = {0, 0, 0};
+    int lineBytes = 0;
+    int window[4] = {0, 0, -1, -1};
+    bool bCompressed = false;
+    for (;;)
+    {
+        const char *name, *type;
+        int size;
+        if (!readString(data, end, name))
+            return false;
+        if (name[0] == 0)
+            break;
+        if (!readString(data, end, type) || !readValue(data, end, size) || size < 0 || end - data < size)
+            return false;
+        const char *value = data;
+        data += size;
+        if (strcmp(name, "channels") == 0)
+        {
+            // Sorted by name, each one takes its share of every line
+            const char *channel = value;
+            for (;;)
+            {
+                const char *channelName;
+                int description[4];
+                if (!readString(channel, data, channelName))
+                    return false;
+                if (channelName[0] == 0)
+                    break;
+                if (!readValue(channel, data, description))
+                    return false;
+                int index = strcmp(channelName, "R") == 0 ? 0 : strcmp(channelName, "G") == 0 ? 1 
+                          : strcmp(channelName, "B") == 0 ? 2 : -1;
+                if (index >= 0)
+                {
+                    channelOffset[index] = lineBytes;
+                    channelType[index] = description[0];
+                }
+                lineBytes += description[0] == exrHalf ? 2 : 4;
+            }
+        }
+        else if (strcmp(name, "compression") == 0)
+        {
+            bCompressed = size != 1 || value[0] != 0;
+        }
+        else if (strcmp(name, "dataWindow") == 0 && size == sizeof(window))
+        {
+            memcpy(window, value, sizeof(window));
+        }
+    }
+    if (bCompressed)
+    {
+        cout << "Mal formed HDR file : only uncompressed OpenEXR files can be read." << endl;
+        return false;
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        if (channelOffset[i] < 0 || channelType[i] == exrUint)
+        {
+            cout << "Mal formed HDR file : R, G and B float or half channels are needed." << endl;
+            return false;
+        }
+    }
+    int width = window[2] - window[0] + 1, height = window[3] - window[1] + 1;
+    if (!allocateImage(width, height, image, fragments))
+        return false;
+
+    // One chunk per line, the chunks hold their line number
+    const char *offsets = data;
+    for (int i = 0; i < height; ++i)
+    {
+        unsigned long long offset;
+        int y, size;
+        if (!readValue(offsets, end, offset) || offset > imageFile.size)
+            return false;
+        const char *chunk = imageFile.data + offset;
+        if (!readValue(chunk, end, y) || !readValue(chunk, end, size))
+            return false;
+        y -= window[1];
+        if (y < 0 || y >= height || size != lineBytes * width || end - chunk < size)
+            return false;
+        for (int fx = 0; fx < width; ++fx)
+        {
+            float rgb[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                // Every channel is stored for the whole line before the next one
+                const char *value = chunk + channelOffset[c] * width;
+                if (channelType[c] == exrHalf)
+                {
+                    unsigned short half;
+                    memcpy(&half, value + 2 * fx, sizeof(half));
+                    rgb[c] = halfToFloat(half);
+                }
+                else
+                {
+                    memcpy(&rgb[c], value + 4 * fx, sizeof(float));
+                }
+            }
+            color &fragment = fragmentAt(image, fx, height - 1 - y);
+            fragment.red = rgb[0];
+            fragment.green = rgb[1];
+            fragment.blue = rgb[2];
+        }
+    }
+    return true;
+}
+
+bool readHdrImage(const char *fileName, hdrImage &image, vector<color> &fragments)
+{
+    mappedFile imageFile;
+    if (!imageFile.Open(fileName))
+        return false;
+    if (imageFile.size >= 2 && imageFile.data[0] == 'P' && imageFile.data[1] == 'F')
+        return readPfm(imageFile, image, fragments);
+    return readExr(imageFile, image, fragments);
+}
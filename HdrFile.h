@@ -0,0 +1,26 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __HDR_FILE_H
+#define __HDR_FILE_H
+
+#include <vector>
+#include "Tonemap.h"
+
+// Linear images before tonemapping, so that they can be tonemapped again
+// without rendering them. The files hold every fragment : they are twice
+// the size of the final image in both directions.
+// A name ending in .exr gives an uncompressed OpenEXR file with 32 bits
+// float channels, any other name a color PFM file.
+bool writeHdrImage(const char *fileName, const hdrImage &image);
+
+// Reads a PFM or an uncompressed OpenEXR file (float or half channels),
+// the fragments are stored in the vector.
+bool readHdrImage(const char *fileName, hdrImage &image, std::vector<color> &fragments);
+
+#endif //__HDR_FILE_H
@@ -0,0 +1,280 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */ 
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+#include <algorithm>
+using namespace std;
+
+#include "Raytrace.h"
+#include "Scene.h"
+#include "Trace.h"
+#include "AllocTracker.h"
+
+static void usage()
+{
+    cout << "Usage : Raytrace.exe [options] Scene.txt Output.tga" << endl;
+    cout << "        Raytrace.exe --compile Scene.txt Scene.rtb" << endl;
+    cout << "        Raytrace.exe --estimate [options] Scene.txt" << endl;
+    cout << "Options : --threads N      number of rendering threads (default one per cpu)" << endl;
+    cout << "          --width W        width of the image (default from the scene)" << endl;
+    cout << "          --height H       height of the image (default from the scene)" << endl;
+    cout << "          --stats          print the render time and the number of rays" << endl;
+    cout << "          --heatmaps name  write name.<counter>.tga/.pfm with the cost of each pixel" << endl;
+    cout << "                           (rays, blob tests, noise, cycles), needs make rt4-stats" << endl;
+    cout << "          --costs report   write the time spent on each object, material and light" << endl;
+    cout << "                           needs make rt4-stats" << endl;
+    cout << "          --hdr out.exr    also write the image before tonemapping, at twice its size" << endl;
+    cout << "                           (.exr for OpenEXR, PFM otherwise), see tools/rt4-tonemap" << endl;
+    cout << "          --time-budget S  render in S seconds at most, the quality is lowered to fit" << endl;
+    cout << "                           and the samples per pixel reached are printed" << endl;
+    cout << "          --estimate       print the cpu time, rays and memory the render would take," << endl;
+    cout << "                           from a sample of its pixels, without rendering it" << endl;
+    cout << "          --wavefront      trace the rays breadth first, stage by stage, instead of" << endl;
+    cout << "                           one path after the other" << endl;
+    cout << "          --sort-rays      with --wavefront, sort the reflected and refracted rays by" << endl;
+    cout << "                           direction and origin, and the misses by direction" << endl;
+    cout << "          --sobol          draw the lens positions and the reflections or refractions" << endl;
+    cout << "                           from Sobol sequences, less noise for the same complexity" << endl;
+    cout << "          --frames A-B     render the frames A to B of an animated scene, the output" << endl;
+    cout << "                           names are patterns like frame%04d.tga" << endl;
+    cout << "          --trace out.json write a timeline of the run (Chrome trace format)" << endl;
+    cout << "                           and print the time spent in each phase" << endl;
+    cout << "          --perf           print the hardware counters of each phase (Linux)" << endl;
+}
+
+static void printBudgetReport(const budgetReport &report)
+{
+    cout << "Time budget : " << report.fSamples << " rays per pixel (" << report.fMinSamples 
+         << " in the worst row), " << report.fragments << " fragments per pixel, depth " << report.maxDepth
+         << ", " << report.passes << " passes, " << (report.bComplete ? "complete" : "needs refinement") << endl;
+}
+
+// Seconds of tracing the estimates take at most, once the first sample is traced
+const double estimateProbeSeconds = 1.0;
+
+static void printEstimate(const renderEstimate &estimate, int nbThreads)
+{
+    cout << "Estimate for " << estimate.width << "x" << estimate.height << " from " << estimate.sampledPixels 
+         << " pixels in " << estimate.strata << " strata (" << estimate.probeSeconds << " s)" << endl;
+    cout << "  cpu time " << estimate.seconds << " s +- " << estimate.secondsError << " s (95%), about "
+         << estimate.seconds / nbThreads << " s on " << nbThreads << " threads" << endl;
+    cout << "  rays     " << estimate.rays << " +- " << estimate.raysError << endl;
+    if (estimate.bCounters)
+    {
+        cout << "  primary " << estimate.primaryRays << ", reflection " << estimate.reflectionRays
+             << ", refraction " << estimate.refractionRays << ", shadow " << estimate.shadowRays << " rays" << endl;
+        cout << "  blob tests " << estimate.blobTests << ", noise calls " << estimate.noiseCalls << endl;
+    }
+    cout << "  memory   " << (estimate.sceneBytes + estimate.imageBytes) / (1024.0 * 1024.0) << " MB (scene "
+         << estimate.sceneBytes / (1024.0 * 1024.0) << " MB, image " << estimate.imageBytes / (1024.0 * 1024.0) 
+         << " MB)" << endl;
+}
+
+// Output names of animations are printf patterns with a single integer, like frame%04d.tga
+static bool isFramePattern(const char *pattern)
+{
+    const char *conversion = strchr(pattern, '%');
+    if (!conversion || strchr(conversion + 1, '%'))
+        return false;
+    ++conversion;
+    while (*conversion >= '0' && *conversion <= '9')
+        ++conversion;
+    return *conversion == 'd';
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 4 && strcmp(argv[1], "--compile") == 0)
+    {
+        // Writes a binary image of the scene that loads without parsing
+        if (!compileScene(argv[2], argv[3]))
+        {
+            cout << "Failure when compiling the Scene file." << endl;
+            return -1;
+        }
+        return 0;
+    }
+    renderOptions options;
+    const char *traceName = NULL;
+    bool bPerf = false;
+    bool bEstimate = false;
+    int firstFrame = 0, lastFrame = -1;
+    char *files[2];
+    int nbFiles = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            options.width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+            options.height = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--stats") == 0)
+            options.bStats = true;
+        else if (strcmp(argv[i], "--heatmaps") == 0 && i + 1 < argc)
+            options.statsPrefix = argv[++i];
+        else if (strcmp(argv[i], "--costs") == 0 && i + 1 < argc)
+            options.costReportName = argv[++i];
+        else if (strcmp(argv[i], "--hdr") == 0 && i + 1 < argc)
+            options.hdrName = argv[++i];
+        else if (strcmp(argv[i], "--time-budget") == 0 && i + 1 < argc)
+        {
+            options.timeBudget = float(atof(argv[++i]));
+            if (options.timeBudget <= 0.0f)
+            {
+                usage();
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            traceName = argv[++i];
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            const char *range = argv[++i];
+            int count = sscanf(range, "%d-%d", &firstFrame, &lastFrame);
+            if (count == 1)
+                lastFrame = firstFrame;
+            if (count < 1 || firstFrame < 0 || lastFrame < firstFrame)
+            {
+                usage();
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--perf") == 0)
+            bPerf = true;
+        else if (strcmp(argv[i], "--estimate") == 0)
+            bEstimate = true;
+        else if (strcmp(argv[i], "--wavefront") == 0)
+            options.bWavefront = true;
+        else if (strcmp(argv[i], "--sort-rays") == 0)
+            options.bSortRays = true;
+        else if (strcmp(argv[i], "--sobol") == 0)
+            options.bSobol = true;
+        else if (argv[i][0] != '-' && nbFiles < 2)
+            files[nbFiles++] = argv[i];
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+    if (nbFiles < (bEstimate ? 1 : 2) || options.width < 0 || options.height < 0)
+    {
+        usage();
+        return -1;
+    }
+#ifndef RT4_PIXEL_STATS
+    if (options.statsPrefix || options.costReportName)
+    {
+        cout << "The heatmaps and the cost report need a build with RT4_PIXEL_STATS defined (make rt4-stats)." << endl;
+        return -1;
+    }
+#endif
+    if (options.bSortRays && !options.bWavefront)
+    {
+        cout << "Only the wavefront engine sorts its rays, --sort-rays needs --wavefront." << endl;
+        return -1;
+    }
+    if (options.bWavefront && (options.statsPrefix || options.costReportName))
+    {
+        cout << "The heatmaps and the cost report are only measured without --wavefront." << endl;
+        return -1;
+    }
+    // The counters are reported in the summary of the phases, with or without a trace file
+    if (bPerf && !perfEnable())
+    {
+        cout << "No performance counter available, the summary only has timings." << endl;
+    }
+    if (traceName || bPerf)
+    {
+        traceEnable();
+        traceThreadName("main");
+    }
+    bool bAnimation = lastFrame >= 0;
+    if (bAnimation && (!isFramePattern(files[1]) || (options.hdrName && !isFramePattern(options.hdrName))))
+    {
+        cout << "The output names of an animation need a frame number pattern, like frame%04d.tga." << endl;
+        return -1;
+    }
+    budgetReport report;
+    if (options.timeBudget > 0.0f)
+        options.budget = &report;
+    scene myScene;
+    if (!init(files[0], myScene))
+    {
+        cout << "Failure when reading the Scene file." << endl;
+        return -1;
+    }
+    if (bEstimate)
+    {
+        // The first frame of an animation, the others cost about the same
+        renderEstimate estimate;
+        estimateRender(myScene, options, estimateProbeSeconds, estimate);
+        int nbThreads = options.threads > 0 ? options.threads : max(1, int(thread::hardware_concurrency()));
+        printEstimate(estimate, nbThreads);
+    }
+    else if (!bAnimation)
+    {
+        if (!draw(files[1], myScene, options))
+        {
+            cout << "Failure when creating the image file." << endl;
+            return -1;
+        }
+        if (options.budget)
+            printBudgetReport(report);
+    }
+    else
+    {
+        // The scene and its cubemap stay loaded,
+        // every frame only moves what is animated
+        float exposure = 0.0f;
+        options.animationExposure = &exposure;
+        const char *hdrPattern = options.hdrName;
+        for (int frame = firstFrame; frame <= lastFrame; ++frame)
+        {
+            traceScope scope("frame", frame);
+            char imageName[1024], hdrName[1024];
+            snprintf(imageName, sizeof(imageName), files[1], frame);
+            if (hdrPattern)
+            {
+                snprintf(hdrName, sizeof(hdrName), hdrPattern, frame);
+                options.hdrName = hdrName;
+            }
+            animateScene(myScene, frame);
+            if (!draw(imageName, myScene, options))
+            {
+                cout << "Failure when creating the image file " << imageName << "." << endl;
+                return -1;
+            }
+            if (options.budget)
+                printBudgetReport(report);
+        }
+    }
+    if (forbiddenAllocations() > 0)
+    {
+        // Only builds with RT4_TRACK_ALLOCS count them
+        cout << forbiddenAllocations() << " heap allocations in the pixel loop, it must not allocate." << endl;
+        return -1;
+    }
+    if (traceName || bPerf)
+    {
+        traceSummary();
+    }
+    if (traceName)
+    {
+        if (!traceWrite(traceName))
+        {
+            cout << "Failure when writing the trace file." << endl;
+            return -1;
+        }
+    }
+    return 0;
+}
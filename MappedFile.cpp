@@ -0,0 +1,116 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "MappedFile.h"
+#include <fstream>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+bool mappedFile::Open(const char *name, bool bPrivate)
+{
+    Close();
+#ifndef _WIN32
+    int fd = open(name, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+    size = size_t(fileStat.st_size);
+    if (size == 0)
+    {
+        // mmap refuses empty mappings, but an empty file is still a valid file
+        close(fd);
+        data = "";
+        return true;
+    }
+    void *address = mmap(NULL, size, bPrivate ? PROT_READ | PROT_WRITE : PROT_READ,
+                         bPrivate ? MAP_PRIVATE : MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const char *>(address);
+    m_bMapped = true;
+    return true;
+#else
+    (void)bPrivate;
+    ifstream currentfile(name, ios_base::binary);
+    if (!currentfile)
+        return false;
+    currentfile.seekg(0, ios_base::end);
+    size = size_t(currentfile.tellg());
+    currentfile.seekg(0, ios_base::beg);
+    char *buffer = new char[size + 1];
+    currentfile.read(buffer, streamsize(size));
+    buffer[size] = '\0';
+    data = buffer;
+    return true;
+#endif
+}
+
+bool mappedFile::Copy(const char *source, size_t sourceSize)
+{
+    Close();
+    char *buffer = new char[sourceSize + 1];
+    memcpy(buffer, source, sourceSize);
+    buffer[sourceSize] = '\0';
+    data = buffer;
+    size = sourceSize;
+    m_bCopied = true;
+    return true;
+}
+
+void mappedFile::Close()
+{
+#ifndef _WIN32
+    if (m_bMapped)
+    {
+        munmap(const_cast<char *>(data), size);
+    }
+    else if (m_bCopied)
+    {
+        delete [] const_cast<char *>(data);
+    }
+#else
+    if (data)
+    {
+        delete [] const_cast<char *>(data);
+    }
+#endif
+    data = NULL;
+    size = 0;
+    m_bMapped = false;
+    m_bCopied = false;
+}
+
+unsigned long long hashBytes(const char *data, size_t size, unsigned long long hash)
+{
+    const unsigned char *current = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = current + size;
+    for (; current != end; ++current)
+    {
+        hash ^= *current;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
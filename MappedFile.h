@@ -0,0 +1,43 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __MAPPED_FILE_H
+#define __MAPPED_FILE_H
+
+#include <cstddef>
+
+// Read only view of a whole file. On POSIX systems the file is memory mapped
+// so that several processes reading the same file share the pages through
+// the page cache. Elsewhere we fall back to reading the file into memory.
+struct mappedFile
+{
+    const char *data;
+    size_t size;
+
+    mappedFile() : data(NULL), size(0), m_bMapped(false), m_bCopied(false) {};
+    ~mappedFile() { Close(); }
+
+    // When bPrivate is true the mapping is copy on write : the content can
+    // be modified in place without affecting the file on disk.
+    bool Open(const char *name, bool bPrivate = false);
+    // Holds a copy of a buffer instead of a file, it can be modified in place too
+    bool Copy(const char *source, size_t sourceSize);
+    void Close();
+    char *privateData() { return const_cast<char *>(data); }
+private:
+    bool m_bMapped;
+    bool m_bCopied;
+    // No copy, the mapping has a single owner
+    mappedFile(const mappedFile &);
+    mappedFile & operator = (const mappedFile &);
+};
+
+// 64 bits FNV-1a hash, used to key caches by the content of their sources.
+unsigned long long hashBytes(const char *data, size_t size, unsigned long long hash = 14695981039346656037ULL);
+
+#endif //__MAPPED_FILE_H
@@ -0,0 +1,138 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "PerfCounters.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+bool g_bPerfEnabled = false;
+
+static const char *counterNames[perfCounters::counterCount] = {
+    "cycles", "instructions", "L1D misses", "LLC misses", "branch misses", "page faults"
+};
+
+const char *perfCounterName(int counter)
+{
+    return counterNames[counter];
+}
+
+#ifdef __linux__
+
+struct perfEvent
+{
+    unsigned int type;
+    unsigned long long config;
+};
+
+static const perfEvent perfEvents[perfCounters::counterCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) 
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+};
+
+// The counters are independent rather than in a group, so that a missing one
+// doesn't take the others down. When there are more of them than hardware
+// registers the kernel multiplexes them, and we scale the counts by the
+// fraction of the time they were really counting.
+struct perfThread
+{
+    int fds[perfCounters::counterCount];
+    bool bOpened;
+    perfThread() : bOpened(false) {}
+    ~perfThread()
+    {
+        if (bOpened)
+            for (int i = 0; i < perfCounters::counterCount; ++i)
+                if (fds[i] >= 0)
+                    close(fds[i]);
+    }
+    void open(int *errors)
+    {
+        for (int i = 0; i < perfCounters::counterCount; ++i)
+        {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = perfEvents[i].type;
+            attr.config = perfEvents[i].config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            // This thread only, on any cpu
+            fds[i] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            if (errors)
+                errors[i] = fds[i] < 0 ? errno : 0;
+        }
+        bOpened = true;
+    }
+};
+
+static thread_local perfThread currentThread;
+
+bool perfEnable()
+{
+    int errors[perfCounters::counterCount];
+    currentThread.open(errors);
+    bool bAny = false;
+    for (int i = 0; i < perfCounters::counterCount; ++i)
+    {
+        if (currentThread.fds[i] >= 0)
+            bAny = true;
+        else
+            cout << "Counter " << counterNames[i] << " unavailable : " << strerror(errors[i]) << endl;
+    }
+    g_bPerfEnabled = bAny;
+    return bAny;
+}
+
+void perfRead(perfCounters &counters)
+{
+    if (!currentThread.bOpened)
+        currentThread.open(NULL);
+    for (int i = 0; i < perfCounters::counterCount; ++i)
+    {
+        // value, time enabled, time running
+        unsigned long long data[3];
+        counters.values[i] = -1;
+        if (currentThread.fds[i] < 0 || read(currentThread.fds[i], data, sizeof(data)) != sizeof(data))
+            continue;
+        if (data[2] == 0)
+            counters.values[i] = 0;
+        else if (data[2] < data[1])
+            counters.values[i] = (long long)(double(data[0]) * data[1] / data[2]);
+        else
+            counters.values[i] = (long long)data[0];
+    }
+}
+
+#else
+
+bool perfEnable()
+{
+    cout << "Performance counters are only supported on Linux." << endl;
+    return false;
+}
+
+void perfRead(perfCounters &counters)
+{
+    for (int i = 0; i < perfCounters::counterCount; ++i)
+        counters.values[i] = -1;
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __PERF_COUNTERS_H
+#define __PERF_COUNTERS_H
+
+// Hardware performance counters of the calling thread, through perf_event_open
+// on Linux. Counters are opened per thread the first time they are read.
+// Any counter that can't be opened (no PMU in a virtual machine, a container
+// that filters the system call, perf_event_paranoid..) reads as -1 and the
+// rest keeps working. On other systems every counter reads as -1.
+
+struct perfCounters
+{
+    enum {
+        cycles = 0,
+        instructions,
+        l1dMisses,
+        llcMisses,
+        branchMisses,
+        pageFaults,
+        counterCount
+    };
+    long long values[counterCount];
+};
+
+extern bool g_bPerfEnabled;
+
+// Opens the counters of the calling thread and tells which ones are
+// available. Returns false when none of them is.
+bool perfEnable();
+
+// Counts of the calling thread since its counters were opened
+void perfRead(perfCounters &counters);
+
+// Short name of each counter, for the reports
+const char *perfCounterName(int counter);
+
+#endif //__PERF_COUNTERS_H
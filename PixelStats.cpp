@@ -0,0 +1,294 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "PixelStats.h"
+
+#ifdef RT4_PIXEL_STATS
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "SimpleString.h"
+#include "Scene.h"
+using namespace std;
+
+thread_local pixelStats g_pixelStats;
+thread_local sceneCosts g_sceneCosts;
+
+static const char *counterNames[pixelStats::counterCount] = {
+    "primary", "reflection", "refraction", "shadow", "blobtests", "noise", "cycles"
+};
+
+void resetPixelStats()
+{
+    memset(&g_pixelStats, 0, sizeof(g_pixelStats));
+}
+
+unsigned long long pixelStatsClock()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Black for the cheapest pixels, then purple, red, orange and pale yellow for the most expensive
+static void falseColour(float value, unsigned char *bgr)
+{
+    static const float ramp[5][3] = {
+        {0.0f, 0.0f, 0.0f},
+        {0.35f, 0.0f, 0.55f},
+        {0.9f, 0.15f, 0.1f},
+        {1.0f, 0.6f, 0.0f},
+        {1.0f, 1.0f, 0.7f}
+    };
+    value = min(max(value, 0.0f), 1.0f) * 4.0f;
+    int i = min(int(value), 3);
+    float t = value - i;
+    for (int c = 0; c < 3; ++c)
+    {
+        float channel = (1.0f - t) * ramp[i][c] + t * ramp[i + 1][c];
+        bgr[2 - c] = (unsigned char)(channel * 255.0f + 0.5f);
+    }
+}
+
+static bool writeHeatmap(const char *fileName, const vector<float> &values, int width, int height)
+{
+    // The scale is set on the 99.5th percentile, a few outliers would make
+    // every other pixel black.
+    vector<float> sorted(values);
+    size_t rank = min(sorted.size() - 1, size_t(sorted.size() * 0.995));
+    nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    float scale = sorted[rank] > 0.0f ? 1.0f / sorted[rank] : 0.0f;
+
+    ofstream imageFile(fileName, ios_base::binary);
+    if (!imageFile)
+        return false;
+    // Same TGA header as the rendered image
+    unsigned char header[18] = {0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        (unsigned char)(width & 0xFF), (unsigned char)(width >> 8),
+        (unsigned char)(height & 0xFF), (unsigned char)(height >> 8), 24, 0};
+    imageFile.write((const char *)header, sizeof(header));
+    vector<unsigned char> pixels(3 * values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+        falseColour(values[i] * scale, &pixels[3 * i]);
+    imageFile.write((const char *)&pixels[0], pixels.size());
+    return bool(imageFile);
+}
+
+// Grey scale PFM, a negative scale means little endian.
+// Rows go from the bottom to the top, like in our TGA files.
+static bool writePfm(const char *fileName, const vector<float> &values, int width, int height)
+{
+    ofstream imageFile(fileName, ios_base::binary);
+    if (!imageFile)
+        return false;
+    imageFile << "Pf\n" << width << " " << height << "\n-1.0\n";
+    imageFile.write((const char *)&values[0], values.size() * sizeof(float));
+    return bool(imageFile);
+}
+
+bool writePixelStats(const char *prefix, const pixelStats *stats, int width, int height)
+{
+    vector<float> values(size_t(width) * height);
+    for (int counter = 0; counter < pixelStats::counterCount; ++counter)
+    {
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = float(stats[i].counters[counter]);
+        SimpleString name(prefix);
+        name.append(".").append(counterNames[counter]);
+        SimpleString tgaName(name);
+        tgaName.append(".tga");
+        name.append(".pfm");
+        if (!writeHeatmap(tgaName.c_str(), values, width, height) 
+            || !writePfm(name.c_str(), values, width, height))
+            return false;
+    }
+    return true;
+}
+
+void sceneCosts::reset(const scene &myScene)
+{
+    objectCost zeroObject = {0, 0, 0};
+    materialCost zeroMaterial = {0, 0, 0, 0, 0};
+    lightCost zeroLight = {0, 0, 0};
+    spheres.assign(myScene.sphereContainer.size(), zeroObject);
+    blobs.assign(myScene.blobContainer.size(), zeroObject);
+    materials.assign(myScene.materialContainer.size(), zeroMaterial);
+    lights.assign(myScene.lightContainer.size(), zeroLight);
+}
+
+static void addObjects(vector<objectCost> &total, const vector<objectCost> &other)
+{
+    for (size_t i = 0; i < total.size(); ++i)
+    {
+        total[i].tests += other[i].tests;
+        total[i].hits += other[i].hits;
+        total[i].cycles += other[i].cycles;
+    }
+}
+
+void sceneCosts::add(const sceneCosts &other)
+{
+    addObjects(spheres, other.spheres);
+    addObjects(blobs, other.blobs);
+    for (size_t i = 0; i < materials.size(); ++i)
+    {
+        materials[i].hits += other.materials[i].hits;
+        materials[i].reflectionRays += other.materials[i].reflectionRays;
+        materials[i].refractionRays += other.materials[i].refractionRays;
+        materials[i].shadowRays += other.materials[i].shadowRays;
+        materials[i].cycles += other.materials[i].cycles;
+    }
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        lights[i].shadowRays += other.lights[i].shadowRays;
+        lights[i].occluded += other.lights[i].occluded;
+        lights[i].cycles += other.lights[i].cycles;
+    }
+}
+
+// Entries of the report are sorted by decreasing cost
+struct costEntry
+{
+    SimpleString name;
+    unsigned long long cycles;
+    size_t index;
+};
+
+struct IsMoreExpensivePredicate
+{
+    bool operator () (const costEntry &elem1, const costEntry &elem2)
+    {
+        return elem1.cycles > elem2.cycles;
+    }
+};
+
+static double percent(unsigned long long part, unsigned long long total)
+{
+    return total ? 100.0 * double(part) / double(total) : 0.0;
+}
+
+static const char *materialDescription(const material &mat)
+{
+    if ((mat.reflection != 0.0f || mat.refraction != 0.0f) && mat.density != 0.0f)
+        return "glass";
+    if (mat.reflection != 0.0f)
+        return "reflective";
+    switch (mat.type)
+    {
+    case material::turbulence: return "turbulence";
+    case material::marble: return "marble";
+    case material::noise: return "noise";
+    default: return "gouraud";
+    }
+}
+
+// Only the most expensive entries of each kind are listed
+const size_t costReportLines = 20;
+
+bool writeCostReport(const char *fileName, const scene &myScene, const sceneCosts &costs)
+{
+    FILE *reportFile = fopen(fileName, "w");
+    if (!reportFile)
+        return false;
+
+    // Spheres and blobs are ranked together by their intersection time
+    vector<costEntry> entries;
+    unsigned long long intersectionCycles = 0, intersectionTests = 0;
+    for (size_t i = 0; i < costs.spheres.size() + costs.blobs.size(); ++i)
+    {
+        bool bSphere = i < costs.spheres.size();
+        size_t index = bSphere ? i : i - costs.spheres.size();
+        costEntry entry;
+        entry.name = bSphere ? "Sphere" : "Blob";
+        entry.name.append((unsigned long) index);
+        entry.cycles = bSphere ? costs.spheres[index].cycles : costs.blobs[index].cycles;
+        entry.index = i;
+        intersectionCycles += entry.cycles;
+        intersectionTests += bSphere ? costs.spheres[index].tests : costs.blobs[index].tests;
+        entries.push_back(entry);
+    }
+    sort(entries.begin(), entries.end(), IsMoreExpensivePredicate());
+    fprintf(reportFile, "Intersections : %llu tests, %.1f Mcycles\n", intersectionTests, intersectionCycles * 1e-6);
+    for (size_t i = 0; i < entries.size() && i < costReportLines; ++i)
+    {
+        bool bSphere = entries[i].index < costs.spheres.size();
+        const objectCost &cost = bSphere ? costs.spheres[entries[i].index] 
+                                         : costs.blobs[entries[i].index - costs.spheres.size()];
+        fprintf(reportFile, "  %s consumed %.1f%% of intersection time (%llu tests, %.0f cycles/test, %llu hits)\n",
+                entries[i].name.c_str(), percent(cost.cycles, intersectionCycles), cost.tests,
+                cost.tests ? double(cost.cycles) / cost.tests : 0.0, cost.hits);
+    }
+    if (entries.size() > costReportLines)
+        fprintf(reportFile, "  and %u more objects\n", unsigned(entries.size() - costReportLines));
+
+    // Shading time includes the shadow rays, secondary rays are the reflected and refracted ones
+    entries.clear();
+    unsigned long long shadingCycles = 0, secondaryRays = 0;
+    for (size_t i = 0; i < costs.materials.size(); ++i)
+    {
+        costEntry entry;
+        entry.name = "Material";
+        entry.name.append((unsigned long) i);
+        entry.cycles = costs.materials[i].cycles;
+        entry.index = i;
+        shadingCycles += entry.cycles;
+        secondaryRays += costs.materials[i].reflectionRays + costs.materials[i].refractionRays;
+        entries.push_back(entry);
+    }
+    sort(entries.begin(), entries.end(), IsMoreExpensivePredicate());
+    fprintf(reportFile, "\nShading : %.1f Mcycles, %llu secondary rays\n", shadingCycles * 1e-6, secondaryRays);
+    for (size_t i = 0; i < entries.size() && i < costReportLines; ++i)
+    {
+        const materialCost &cost = costs.materials[entries[i].index];
+        fprintf(reportFile, "  %s %s consumed %.1f%% of shading time and caused %.1f%% of secondary rays"
+                " (%llu hits, %llu reflected, %llu refracted, %llu shadow rays)\n",
+                entries[i].name.c_str(), materialDescription(myScene.materialContainer[entries[i].index]),
+                percent(cost.cycles, shadingCycles), 
+                percent(cost.reflectionRays + cost.refractionRays, secondaryRays),
+                cost.hits, cost.reflectionRays, cost.refractionRays, cost.shadowRays);
+    }
+    if (entries.size() > costReportLines)
+        fprintf(reportFile, "  and %u more materials\n", unsigned(entries.size() - costReportLines));
+
+    entries.clear();
+    unsigned long long lightCycles = 0;
+    for (size_t i = 0; i < costs.lights.size(); ++i)
+    {
+        costEntry entry;
+        entry.name = "Light";
+        entry.name.append((unsigned long) i);
+        entry.cycles = costs.lights[i].cycles;
+        entry.index = i;
+        lightCycles += entry.cycles;
+        entries.push_back(entry);
+    }
+    sort(entries.begin(), entries.end(), IsMoreExpensivePredicate());
+    fprintf(reportFile, "\nLights : %.1f Mcycles\n", lightCycles * 1e-6);
+    for (size_t i = 0; i < entries.size() && i < costReportLines; ++i)
+    {
+        const lightCost &cost = costs.lights[entries[i].index];
+        fprintf(reportFile, "  %s consumed %.1f%% of lighting time (%llu shadow rays, %.1f%% occluded)\n",
+                entries[i].name.c_str(), percent(cost.cycles, lightCycles), cost.shadowRays,
+                percent(cost.occluded, cost.shadowRays));
+    }
+    if (entries.size() > costReportLines)
+        fprintf(reportFile, "  and %u more lights\n", unsigned(entries.size() - costReportLines));
+
+    return fclose(reportFile) == 0;
+}
+
+#endif // RT4_PIXEL_STATS
@@ -0,0 +1,100 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __PIXEL_STATS_H
+#define __PIXEL_STATS_H
+
+// Per pixel cost counters, to find out which parts of an image are expensive,
+// and cost of each object of the scene, to find out which ones are.
+// They only exist when compiling with RT4_PIXEL_STATS defined (make rt4-stats),
+// otherwise PIXEL_STAT expands to nothing and the renderer is left untouched.
+
+#ifdef RT4_PIXEL_STATS
+
+#include <vector>
+struct scene;
+
+struct pixelStats
+{
+    enum {
+        primary = 0,
+        reflection,
+        refraction,
+        shadow,
+        blobTests,
+        noise,
+        cycles,
+        counterCount
+    };
+    // Cycles when the cpu has a time stamp counter, nanoseconds otherwise
+    unsigned long long counters[counterCount];
+};
+
+// Counters of the pixel being rendered by the current thread
+extern thread_local pixelStats g_pixelStats;
+
+#define PIXEL_STAT(counter, n) (g_pixelStats.counters[pixelStats::counter] += (n))
+
+void resetPixelStats();
+unsigned long long pixelStatsClock();
+
+// Writes prefix.<counter>.tga, a false colour image of each counter,
+// and prefix.<counter>.pfm with the raw values as floats.
+bool writePixelStats(const char *prefix, const pixelStats *stats, int width, int height);
+
+// Cost of every object, material and light of the scene.
+// Each thread charges its own copy, they are added up at the end of the render.
+struct objectCost
+{
+    unsigned long long tests, hits, cycles;
+    void charge(unsigned long long start) { tests++; cycles += pixelStatsClock() - start; }
+};
+
+struct materialCost
+{
+    unsigned long long hits, reflectionRays, refractionRays, shadowRays, cycles;
+};
+
+struct lightCost
+{
+    unsigned long long shadowRays, occluded, cycles;
+};
+
+struct sceneCosts
+{
+    bool bEnabled;
+    std::vector<objectCost> spheres, blobs;
+    std::vector<materialCost> materials;
+    std::vector<lightCost> lights;
+    sceneCosts() : bEnabled(false) {}
+    void reset(const scene &myScene);
+    void add(const sceneCosts &other);
+};
+
+extern thread_local sceneCosts g_sceneCosts;
+
+// Timing of an intersection test, charged to one object
+#define COST_START(start) unsigned long long start = g_sceneCosts.bEnabled ? pixelStatsClock() : 0
+#define COST_TEST(container, index, start) \
+    (g_sceneCosts.bEnabled ? g_sceneCosts.container[index].charge(start) : (void)0)
+#define COST_ADD(container, index, field, n) \
+    (g_sceneCosts.bEnabled ? (void)(g_sceneCosts.container[index].field += (n)) : (void)0)
+
+// Writes the objects, materials and lights sorted by the time they cost
+bool writeCostReport(const char *fileName, const scene &myScene, const sceneCosts &costs);
+
+#else
+
+#define PIXEL_STAT(counter, n) ((void)0)
+#define COST_START(start) 
+#define COST_TEST(container, index, start) ((void)0)
+#define COST_ADD(container, index, field, n) ((void)0)
+
+#endif // RT4_PIXEL_STATS
+
+#endif //__PIXEL_STATS_H
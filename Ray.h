@@ -1,19 +1,19 @@
-/*
-    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
-    It is free to use for educational purpose and cannot be redistributed
-    outside of the tutorial pages.
-    Any further inquiry :
-    mailto:info@codermind.com
- */
-
-#ifndef _RAY_H
-#define _RAY_H
-
-#include "Def.h"
-
-struct ray {
-	point start;
-	vecteur dir;
-};
-
-#endif // _RAY_H
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef _RAY_H
+#define _RAY_H
+
+#include "Def.h"
+
+struct ray {
+	point start;
+	vecteur dir;
+};
+
+#endif // _RAY_H
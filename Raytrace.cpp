@@ -1,601 +1,1506 @@
-/*
-    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
-    It is free to use for educational purpose and cannot be redistributed
-    outside of the tutorial pages.
-    Any further inquiry :
-    mailto:info@codermind.com
- */ 
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <cmath>
-#include <limits>
-#include <algorithm>
-using namespace std;
-
-#include "Ray.h"
-#include "Raytrace.h"
-#include "SimpleString.h"
-#include "Texture.h"
-#include "Perlin.h"
-#include "Scene.h"
-#include "Srgb.h"
-
-bool hitSphere(const ray &r, const sphere& s, float &t)
-{
-    // Intersection of a ray and a sphere
-    // Check the articles for the rationale
-    // NB : this is probably a naive solution
-    // that could cause precision problems
-    // but that will do it for now. 
-    vecteur dist = s.pos - r.start;
-    float B = (r.dir.x * dist.x + r.dir.y * dist.y + r.dir.z * dist.z);
-    float D = B*B - dist*dist + s.size * s.size;
-    if (D < 0.0f) return false;
-    float t0 = B - sqrtf(D);
-    float t1 = B + sqrtf(D);
-    bool retvalue = false;
-    if ((t0 > 0.1f ) && (t0 < t))
-    {
-        t = t0;
-        retvalue = true;
-    }
-    if ((t1 > 0.1f ) && (t1 < t))
-    {
-        t = t1;
-        retvalue = true;
-    }
-    return retvalue;
-}
-
-color addRay(ray viewRay, scene &myScene, context myContext)
-{
-    color output = {0.0f, 0.0f, 0.0f}; 
-    float coef = 1.0f;
-    int level = 0;
-    do 
-    {
-        point ptHitPoint;
-        vecteur vNormal;
-        material currentMat;
-        {
-            int currentBlob=-1;
-            int currentSphere=-1;
-            float t = 2000.0f;
-            for (unsigned int i = 0; i < myScene.blobContainer.size() ; ++i)
-            {
-                if (isBlobIntersected(viewRay, myScene.blobContainer[i], t)) {
-                    currentBlob = i;
-                }
-            }
-            for (unsigned int i = 0; i < myScene.sphereContainer.size() ; ++i)
-            {
-                if (hitSphere(viewRay, myScene.sphereContainer[i], t))
-                {
-                    currentSphere = i;
-                    currentBlob = -1;
-                }
-            }
-            if (currentBlob != -1)
-            {
-                ptHitPoint  = viewRay.start + t * viewRay.dir;
-                blobInterpolation(ptHitPoint, myScene.blobContainer[currentBlob], vNormal);
-                float temp = vNormal * vNormal;
-                if (temp == 0.0f)
-                    break;
-                vNormal = invsqrtf(temp) * vNormal;
-                currentMat = myScene.materialContainer[myScene.blobContainer[currentBlob].materialId];
-            }
-            else if (currentSphere != -1)
-            {
-                ptHitPoint  = viewRay.start + t * viewRay.dir;
-                vNormal = ptHitPoint - myScene.sphereContainer[currentSphere].pos;
-                float temp = vNormal * vNormal;
-                if (temp == 0.0f)
-                    break;
-                temp = invsqrtf(temp);
-                vNormal = temp * vNormal;
-                currentMat = myScene.materialContainer[myScene.sphereContainer[currentSphere].materialId];
-            }
-            else
-            {
-                break;
-            }
-        }
-
-        float bInside;
-
-        if (vNormal * viewRay.dir > 0.0f)
-        {
-            vNormal = -1.0f * vNormal;
-            bInside = true;
-        }
-        else
-        {
-            bInside = false;
-        }
-
-        if (currentMat.bump)
-        {
-            float noiseCoefx = float(noise(0.1 * double(ptHitPoint.x), 0.1 * double(ptHitPoint.y),0.1 * double(ptHitPoint.z)));
-            float noiseCoefy = float(noise(0.1 * double(ptHitPoint.y), 0.1 * double(ptHitPoint.z),0.1 * double(ptHitPoint.x)));
-            float noiseCoefz = float(noise(0.1 * double(ptHitPoint.z), 0.1 * double(ptHitPoint.x),0.1 * double(ptHitPoint.y)));
-            
-            vNormal.x = (1.0f - currentMat.bump ) * vNormal.x + currentMat.bump * noiseCoefx;  
-            vNormal.y = (1.0f - currentMat.bump ) * vNormal.y + currentMat.bump * noiseCoefy;  
-            vNormal.z = (1.0f - currentMat.bump ) * vNormal.z + currentMat.bump * noiseCoefz;  
-            
-            float temp = vNormal * vNormal;
-            if (temp == 0.0f)
-            break;
-            temp = invsqrtf(temp);
-            vNormal = temp * vNormal;
-        }
-        
-        float fViewProjection = viewRay.dir * vNormal;
-        float fReflectance, fTransmittance;
-        float fCosThetaI, fSinThetaI, fCosThetaT, fSinThetaT;
-
-        if(((currentMat.reflection != 0.0f) || (currentMat.refraction != 0.0f) ) && (currentMat.density != 0.0f))
-        {
-            // glass-like material, we're computing the fresnel coefficient.
-
-            float fDensity1 = myContext.fRefractionCoef; 
-            float fDensity2;
-            if (bInside)
-            {
-                // We only consider the case where the ray is originating a medium close to the void (or air) 
-                // In theory, we should first determine if the current object is inside another one
-                // but that's beyond the purpose of our code.
-                fDensity2 = context::getDefaultAir().fRefractionCoef;
-            }
-            else
-            {
-                fDensity2 = currentMat.density;
-            }
-
-            // Here we take into account that the light movement is symmetrical
-            // From the observer to the source or from the source to the oberver.
-            // We then do the computation of the coefficient by taking into account
-            // the ray coming from the viewing point.
-            fCosThetaI = fabsf(fViewProjection); 
-
-            if (fCosThetaI >= 0.999f) 
-            {
-                // In this case the ray is coming parallel to the normal to the surface
-                fReflectance = (fDensity1 - fDensity2) / (fDensity1 + fDensity2);
-                fReflectance = fReflectance * fReflectance;
-                fSinThetaI = 0.0f;
-                fSinThetaT = 0.0f;
-                fCosThetaT = 1.0f;
-            }
-            else 
-            {
-                fSinThetaI = sqrtf(1 - fCosThetaI * fCosThetaI);
-                // The sign of SinThetaI has no importance, it is the same as the one of SinThetaT
-                // and they vanish in the computation of the reflection coefficient.
-                fSinThetaT = (fDensity1 / fDensity2) * fSinThetaI;
-                if (fSinThetaT * fSinThetaT > 0.9999f)
-                {
-                    // Beyond that angle all surfaces are purely reflective
-                    fReflectance = 1.0f ;
-                    fCosThetaT = 0.0f;
-                }
-                else
-                {
-                    fCosThetaT = sqrtf(1 - fSinThetaT * fSinThetaT);
-                    // First we compute the reflectance in the plane orthogonal 
-                    // to the plane of reflection.
-                    float fReflectanceOrtho = (fDensity2 * fCosThetaT - fDensity1 * fCosThetaI ) 
-                        / (fDensity2 * fCosThetaT + fDensity1  * fCosThetaI);
-                    fReflectanceOrtho = fReflectanceOrtho * fReflectanceOrtho;
-                    // Then we compute the reflectance in the plane parallel to the plane of reflection
-                    float fReflectanceParal = (fDensity1 * fCosThetaT - fDensity2 * fCosThetaI )
-                        / (fDensity1 * fCosThetaT + fDensity2 * fCosThetaI);
-                    fReflectanceParal = fReflectanceParal * fReflectanceParal;
-
-                    // The reflectance coefficient is the average of those two.
-                    // If we consider a light that hasn't been previously polarized.
-                    fReflectance =  0.5f * (fReflectanceOrtho + fReflectanceParal);
-                }
-            }
-        }
-        else
-        {
-            // Reflection in a metal-like material. Reflectance is equal in all directions.
-            // Note, that metal are conducting electricity and as such change the polarity of the
-            // reflected ray. But of course we ignore that..
-            fReflectance = 1.0f;
-            fCosThetaI = 1.0f;
-            fCosThetaT = 1.0f;
-        }
-
-        fTransmittance = currentMat.refraction * (1.0f - fReflectance);
-        fReflectance = currentMat.reflection * fReflectance;
-
-        float fTotalWeight = fReflectance + fTransmittance;
-        bool bDiffuse = false;
-
-        if (fTotalWeight > 0.0f)
-        {
-            float fRoulette = (1.0f / RAND_MAX) * rand();
-        
-            if (fRoulette <= fReflectance)
-            {
-                coef *= currentMat.reflection;
-
-                float fReflection = - 2.0f * fViewProjection;
-
-                viewRay.start = ptHitPoint;
-                viewRay.dir += fReflection * vNormal;
-            }
-            else if(fRoulette <= fTotalWeight)
-            {
-                coef *= currentMat.refraction;
-                float fOldRefractionCoef = myContext.fRefractionCoef;
-                if (bInside) 
-                {
-                    myContext.fRefractionCoef = context::getDefaultAir().fRefractionCoef;
-                }
-                else
-                {
-                    myContext.fRefractionCoef = currentMat.density;
-                }
-
-                // Here we compute the transmitted ray with the formula of Snell-Descartes
-                viewRay.start = ptHitPoint;
-
-                viewRay.dir = viewRay.dir + fCosThetaI * vNormal;
-                viewRay.dir = (fOldRefractionCoef / myContext.fRefractionCoef) * viewRay.dir;
-                viewRay.dir += (-fCosThetaT) * vNormal;
-            }
-            else
-            {
-                bDiffuse = true;
-            }
-        }
-        else
-        {
-            bDiffuse = true;
-        }
-
-
-        if (!bInside && bDiffuse)
-        {
-            // Now the "regular lighting"
-
-            ray lightRay;
-            lightRay.start = ptHitPoint;
-            for (unsigned int j = 0; j < myScene.lightContainer.size() ; ++j)
-            {
-                light currentLight = myScene.lightContainer[j];
-
-                lightRay.dir = currentLight.pos - ptHitPoint;
-                float fLightProjection = lightRay.dir * vNormal;
-
-                if ( fLightProjection <= 0.0f )
-                    continue;
-
-                float lightDist = lightRay.dir * lightRay.dir;
-                {
-                    float temp = lightDist;
-                    if ( temp == 0.0f )
-                        continue;
-                    temp = invsqrtf(temp);
-                    lightRay.dir = temp * lightRay.dir;
-                    fLightProjection = temp * fLightProjection;
-                }
-
-                bool inShadow = false;
-                {
-                    float t = lightDist;
-                    for (unsigned int i = 0; i < myScene.sphereContainer.size() ; ++i)
-                    {
-                        if (hitSphere(lightRay, myScene.sphereContainer[i], t))
-                        {
-                            inShadow = true;
-                            break;
-                        }
-                    }
-                    for (unsigned int i = 0; i < myScene.blobContainer.size() ; ++i)
-                    {
-                        if (isBlobIntersected(lightRay, myScene.blobContainer[i], t)) {
-                            inShadow = true;
-                            break;
-                        }
-                    }
-                }
-
-                if (!inShadow && (fLightProjection > 0.0f))
-                {
-
-                    float lambert = (lightRay.dir * vNormal) * coef;
-                    float noiseCoef = 0.0f;
-                    switch(currentMat.type)
-                    {
-                    case material::turbulence:
-                        {
-                            for (int level = 1; level < 10; level ++)
-                            {
-                                noiseCoef += (1.0f / level )  
-                                    * fabsf(float(noise(level * 0.05 * ptHitPoint.x,  
-                                                        level * 0.05 * ptHitPoint.y,
-                                                        level * 0.05 * ptHitPoint.z)));
-                            };
-                            output = output +  coef * (lambert * currentLight.intensity)  
-                                    * (noiseCoef * currentMat.diffuse + (1.0f - noiseCoef) * currentMat.diffuse2);
-                        }
-                        break;
-                    case material::marble:
-                        {
-                        for (int level = 1; level < 10; level ++)
-                        {
-                            noiseCoef +=  (1.0f / level)  
-                            * fabsf(float(noise(level * 0.05 * ptHitPoint.x,  
-                                                level * 0.05 * ptHitPoint.y,  
-                                                level * 0.05 * ptHitPoint.z)));
-                        };
-                        noiseCoef = 0.5f * sinf( (ptHitPoint.x + ptHitPoint.y) * 0.05f + noiseCoef) + 0.5f;
-                        output = output +  coef * (lambert * currentLight.intensity)  
-                            * (noiseCoef * currentMat.diffuse + (1.0f - noiseCoef) * currentMat.diffuse2);
-                        }
-                        break;
-                    default:
-                        {
-                        output.red += lambert * currentLight.intensity.red * currentMat.diffuse.red;
-                        output.green += lambert * currentLight.intensity.green * currentMat.diffuse.green;
-                        output.blue += lambert * currentLight.intensity.blue * currentMat.diffuse.blue;
-                        }
-                        break;
-                    }
-
-                    // Blinn 
-                    // The direction of Blinn is exactly at mid point of the light ray 
-                    // and the view ray. 
-                    // We compute the Blinn vector and then we normalize it
-                    // then we compute the coeficient of blinn
-                    // which is the specular contribution of the current light.
-
-                    vecteur blinnDir = lightRay.dir - viewRay.dir;
-                    float temp = blinnDir * blinnDir;
-                    if (temp != 0.0f )
-                    {
-                        float blinn = invsqrtf(temp) * max(fLightProjection - fViewProjection , 0.0f);
-                        blinn = coef * powf(blinn, currentMat.power);
-                        output += blinn *currentMat.specular  * currentLight.intensity;
-                    }
-                }
-            }
-            coef = 0.0f ;
-        }
-
-        level++;
-    } while ((coef > 0.0f) && (level < 10));  
-
-    if (coef > 0.0f)
-    {
-        output += coef * readCubemap(myScene.cm, viewRay);
-    }
-    return output;
-}
-
-float AutoExposure(scene &myScene)
-{
-    #define ACCUMULATION_SIZE 16
-    float exposure = -1.0f;
-    float accufacteur = float(max(myScene.sizex, myScene.sizey));
-
-    accufacteur = accufacteur / ACCUMULATION_SIZE;
-
-    float mediumPoint = 0.0f;
-    const float mediumPointWeight = 1.0f / (ACCUMULATION_SIZE*ACCUMULATION_SIZE);
-    for (int y = 0; y < ACCUMULATION_SIZE; ++y) {
-        for (int x = 0 ; x < ACCUMULATION_SIZE; ++x) {
-
-            if (myScene.persp.type == perspective::orthogonal)
-            {
-                ray viewRay = { {float(x)*accufacteur, float(y) * accufacteur, -1000.0f}, { 0.0f, 0.0f, 1.0f}};
-                color currentColor = addRay (viewRay, myScene, context::getDefaultAir());
-                float luminance = 0.2126f * currentColor.red
-                                + 0.715160f * currentColor.green
-                                + 0.072169f * currentColor.blue;
-                mediumPoint = mediumPoint + mediumPointWeight * (luminance * luminance);
-            }
-            else
-            {
-                vecteur dir = {(float(x)*accufacteur - 0.5f * myScene.sizex) * myScene.persp.invProjectionDistance, 
-                                (float(y) * accufacteur - 0.5f * myScene.sizey) * myScene.persp.invProjectionDistance, 
-                                1.0f}; 
-
-                float norm = dir * dir;
-                // I don't think this can happen but we've never too prudent
-                if (norm == 0.0f) 
-                    break;
-                dir = invsqrtf(norm) * dir;
-
-                ray viewRay = { {0.5f * myScene.sizex,  0.5f * myScene.sizey, 0.0f}, {dir.x, dir.y, dir.z} };
-                color currentColor = addRay (viewRay, myScene, context::getDefaultAir());
-                float luminance = 0.2126f * currentColor.red
-                                + 0.715160f * currentColor.green
-                                + 0.072169f * currentColor.blue;
-                mediumPoint = mediumPoint + mediumPointWeight * (luminance * luminance);
-            }
-        }
-    }
-    
-    float mediumLuminance = sqrtf(mediumPoint);
-
-    if (mediumLuminance > 0.0f)
-    {
-        exposure = - logf(1.0f - myScene.tonemap.fMidPoint) / mediumLuminance;
-    }
-
-    return exposure;
-}
-
-bool draw(char* outputName, scene &myScene)
-{
-    int x, y;
-    ofstream imageFile(outputName,ios_base::binary);
-    if (!imageFile)
-        return false;
-    // Addition of the TGA header
-    imageFile.put(0).put(0);
-    imageFile.put(2);        /* RGB not compressed */
-
-    imageFile.put(0).put(0);
-    imageFile.put(0).put(0);
-    imageFile.put(0);
-
-    imageFile.put(0).put(0); /* origin X */ 
-    imageFile.put(0).put(0); /* origin Y */
-
-    imageFile.put((unsigned char)(myScene.sizex & 0x00FF)).put((unsigned char)((myScene.sizex & 0xFF00) / 256));
-    imageFile.put((unsigned char)(myScene.sizey & 0x00FF)).put((unsigned char)((myScene.sizey & 0xFF00) / 256));
-    imageFile.put(24);                 /* 24 bit bitmap */
-    imageFile.put(0);
-    // end of the TGA header 
-
-    float exposure = AutoExposure(myScene);
-
-    for (y = 0; y < myScene.sizey; ++y)
-    for (x = 0 ; x < myScene.sizex; ++x)
-    {
-        if (y < 10)
-        {
-            // Use ten lines in the final image as an intensity calibration hint
-            if ((x / 10) & 1)
-            {
-                imageFile.put((unsigned char)186).put((unsigned char)186).put((unsigned char)186);
-            }
-            else if ( y & 1)
-            {
-                imageFile.put((unsigned char)255).put((unsigned char)255).put((unsigned char)255);
-            }
-            else
-            {
-                imageFile.put((unsigned char)0).put((unsigned char)0).put((unsigned char)0);
-            }
-        }
-        else
-        {
-            color output = {0.0f, 0.0f, 0.0f};
-            for (float fragmentx = float(x) ; fragmentx < x + 1.0f; fragmentx += 0.5f )
-            for (float fragmenty = float(y) ; fragmenty < y + 1.0f; fragmenty += 0.5f )
-            {
-                float sampleRatio = 0.25f;
-                color temp = {0.0f, 0.0f, 0.0f};
-                float fTotalWeight = 0.0f;
-
-                if (myScene.persp.type == perspective::orthogonal)
-                {
-                    ray viewRay = { {fragmentx, fragmenty, -10000.0f}, { 0.0f, 0.0f, 1.0f}};
-                    for (int i = 0; i < myScene.complexity; ++i)
-                    {                  
-                        color rayResult = addRay (viewRay, myScene, context::getDefaultAir());
-                        fTotalWeight += 1.0f; 
-                        temp += rayResult;
-                    }
-                    temp = (1.0f / fTotalWeight) * temp;
-                }
-                else
-                {
-                    vecteur dir = {(fragmentx - 0.5f * myScene.sizex) * myScene.persp.invProjectionDistance, 
-                                (fragmenty - 0.5f * myScene.sizey) * myScene.persp.invProjectionDistance, 
-                                1.0f}; 
-
-                    float norm = dir * dir;
-                    if (norm == 0.0f) 
-                        break;
-                    dir = invsqrtf(norm) * dir;
-                    // the starting point is always the optical center of the camera
-                    // we will add some perturbation later to simulate a depth of field effect
-                    point start = {0.5f * myScene.sizex,  0.5f * myScene.sizey, 0.0f};
-                    // The point aimed is one of the invariant of the current pixel
-                    // that means that by design every ray that contribute to the current
-                    // pixel must go through that point in space (on the "sharp" plane)
-                    // of course the divergence is caused by the direction of the ray itself.
-                    point ptAimed = start + myScene.persp.clearPoint * dir;
-
-                    for (int i = 0; i < myScene.complexity; ++i)
-                    {                  
-                        ray viewRay = { {start.x, start.y, start.z}, {dir.x, dir.y, dir.z} };
-
-                        if (myScene.persp.dispersion != 0.0f)
-                        {
-                            vecteur vDisturbance;                        
-                            vDisturbance.x = (myScene.persp.dispersion / RAND_MAX) * (1.0f * rand());
-                            vDisturbance.y = (myScene.persp.dispersion / RAND_MAX) * (1.0f * rand());
-                            vDisturbance.z = 0.0f;
-
-                            viewRay.start = viewRay.start + vDisturbance;
-                            viewRay.dir = ptAimed - viewRay.start;
-                            
-                            norm = viewRay.dir * viewRay.dir;
-                            if (norm == 0.0f)
-                                break;
-                            viewRay.dir = invsqrtf(norm) * viewRay.dir;
-                        }
-                        color rayResult = addRay (viewRay, myScene, context::getDefaultAir());
-                        fTotalWeight += 1.0f;
-                        temp += rayResult;
-                    }
-                    temp = (1.0f / fTotalWeight) * temp;
-                }
-                
-                // pseudo photo exposure
-                temp.blue   *= exposure;
-                temp.red    *= exposure;
-                temp.green  *= exposure;
-
-                if (myScene.tonemap.fBlack > 0.0f)
-                {
-                    temp.blue   = 1.0f - expf(myScene.tonemap.fPowerScale * powf(temp.blue, myScene.tonemap.fPower)   
-                                              / (myScene.tonemap.fBlack + powf(temp.blue, myScene.tonemap.fPower - 1.0f)) );
-                    temp.red    = 1.0f - expf(myScene.tonemap.fPowerScale * powf(temp.red, myScene.tonemap.fPower)    
-                                              / (myScene.tonemap.fBlack + powf(temp.red, myScene.tonemap.fPower - 1.0f)) );
-                    temp.green  = 1.0f - expf(myScene.tonemap.fPowerScale * powf(temp.green, myScene.tonemap.fPower)  
-                                              / (myScene.tonemap.fBlack + powf(temp.green, myScene.tonemap.fPower - 1.0f)) );
-                }
-                else
-                {
-                    // If the black level is 0 then all other parameters have no effect
-                    temp.blue   = 1.0f - expf(myScene.tonemap.fPowerScale * temp.blue);
-                    temp.red    = 1.0f - expf(myScene.tonemap.fPowerScale * temp.red);
-                    temp.green  = 1.0f - expf(myScene.tonemap.fPowerScale * temp.green);
-                }
-                
-                output += sampleRatio * temp;
-            }
-                        
-            // gamma correction
-            output.blue = srgbEncode(output.blue);
-            output.red = srgbEncode(output.red);
-            output.green = srgbEncode(output.green);
-
-            imageFile.put((unsigned char)min(output.blue*255.0f,255.0f)).put((unsigned char)min(output.green*255.0f, 255.0f)).put((unsigned char)min(output.red*255.0f, 255.0f));
-        }
-    }
-    return true;
-}
-
-int main(int argc, char* argv[])
-{
-    if (argc < 3)
-    {
-        cout << "Usage : Raytrace.exe Scene.txt Output.tga" << endl;
-        return -1;
-    }
-    scene myScene;
-    if (!init(argv[1], myScene))
-    {
-        cout << "Failure when reading the Scene file." << endl;
-        return -1;
-    }
-    if (!draw(argv[2], myScene))
-    {
-        cout << "Failure when creating the image file." << endl;
-        return -1;
-    }
-    return 0;
-}
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */ 
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <cstring>
+using namespace std;
+
+#include "Ray.h"
+#include "Raytrace.h"
+#include "SimpleString.h"
+#include "Texture.h"
+#include "Perlin.h"
+#include "Scene.h"
+#include "Tonemap.h"
+#include "HdrFile.h"
+#include "Trace.h"
+#include "PixelStats.h"
+#include "AllocTracker.h"
+#include "Wavefront.h"
+#include "Sampler.h"
+
+bool hitSphere(const ray &r, const sphere& s, float &t)
+{
+    // Intersection of a ray and a sphere
+    // Check the articles for the rationale
+    // NB : this is probably a naive solution
+    // that could cause precision problems
+    // but that will do it for now. 
+    vecteur dist = s.pos - r.start;
+    float B = (r.dir.x * dist.x + r.dir.y * dist.y + r.dir.z * dist.z);
+    float D = B*B - dist*dist + s.size * s.size;
+    if (D < 0.0f) return false;
+    float t0 = B - sqrtf(D);
+    float t1 = B + sqrtf(D);
+    bool retvalue = false;
+    if ((t0 > 0.1f ) && (t0 < t))
+    {
+        t = t0;
+        retvalue = true;
+    }
+    if ((t1 > 0.1f ) && (t1 < t))
+    {
+        t = t1;
+        retvalue = true;
+    }
+    return retvalue;
+}
+
+// Number of rays traced by the current thread
+static thread_local unsigned long long rayCounter = 0;
+
+static thread_local unsigned int randomState = 0;
+// Bounces of the rays traced by the calling thread when it isn't the MaxDepth
+// of the scene, set by the passes of a time budget (see renderJob). 0 for none.
+static thread_local int depthOverride = 0;
+
+void seedRandom(unsigned int seed)
+{
+    // Scramble the seed, consecutive seeds would give correlated sequences
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6BU;
+    seed ^= seed >> 13;
+    seed *= 0xC2B2AE35U;
+    seed ^= seed >> 16;
+    randomState = seed;
+}
+
+float randomUnit()
+{
+    randomState = randomState * 1664525U + 1013904223U;
+    return float(randomState >> 8) * (1.0f / 16777215.0f);
+}
+
+// Rays drawing their numbers from the Sobol sequence of their fragment (Sampler.h)
+// instead of randomUnit, with the seed of that sequence and the index of the ray in it
+static thread_local bool bSobolSampling = false;
+static thread_local unsigned int fragmentSeed = 0, fragmentSample = 0;
+
+// Dimensions of the sequences : the lens position, then the roulette of every bounce,
+// each one in a pair of its own
+const unsigned int lensDimension = 0;
+const unsigned int rouletteDimension = 2;
+
+// Number in [0, 1] of a dimension, for the ray being traced
+static inline float sampleUnit(unsigned int dimension)
+{
+    if (bSobolSampling)
+        return sobolSample(fragmentSample, dimension, fragmentSeed);
+    return randomUnit();
+}
+
+float turbulenceNoise(const point &p)
+{
+    float noiseCoef = 0.0f;
+    for (int level = 1; level < 10; level ++)
+    {
+        noiseCoef += (1.0f / level )  
+            * fabsf(float(noise(level * 0.05 * p.x,  
+                                level * 0.05 * p.y,
+                                level * 0.05 * p.z)));
+    };
+    return noiseCoef;
+}
+
+float marbleNoise(const point &p)
+{
+    float noiseCoef = 0.0f;
+    for (int level = 1; level < 10; level ++)
+    {
+        noiseCoef +=  (1.0f / level)  
+        * fabsf(float(noise(level * 0.05 * p.x,  
+                            level * 0.05 * p.y,  
+                            level * 0.05 * p.z)));
+    };
+    return 0.5f * sinf( (p.x + p.y) * 0.05f + noiseCoef) + 0.5f;
+}
+
+bool bumpNormal(const material &currentMat, const point &ptHitPoint, vecteur &vNormal)
+{
+    float noiseCoefx = float(noise(0.1 * double(ptHitPoint.x), 0.1 * double(ptHitPoint.y),0.1 * double(ptHitPoint.z)));
+    float noiseCoefy = float(noise(0.1 * double(ptHitPoint.y), 0.1 * double(ptHitPoint.z),0.1 * double(ptHitPoint.x)));
+    float noiseCoefz = float(noise(0.1 * double(ptHitPoint.z), 0.1 * double(ptHitPoint.x),0.1 * double(ptHitPoint.y)));
+    
+    vNormal.x = (1.0f - currentMat.bump ) * vNormal.x + currentMat.bump * noiseCoefx;  
+    vNormal.y = (1.0f - currentMat.bump ) * vNormal.y + currentMat.bump * noiseCoefy;  
+    vNormal.z = (1.0f - currentMat.bump ) * vNormal.z + currentMat.bump * noiseCoefz;  
+    
+    float temp = vNormal * vNormal;
+    if (temp == 0.0f)
+        return false;
+    temp = invsqrtf(temp);
+    vNormal = temp * vNormal;
+    return true;
+}
+
+void fresnelTerms(const material &currentMat, float fViewProjection, bool bInside, float fRefractionCoef,
+                  float &fReflectance, float &fCosThetaI, float &fCosThetaT)
+{
+    float fSinThetaI, fSinThetaT;
+    if(((currentMat.reflection != 0.0f) || (currentMat.refraction != 0.0f) ) && (currentMat.density != 0.0f))
+    {
+        // glass-like material, we're computing the fresnel coefficient.
+
+        float fDensity1 = fRefractionCoef; 
+        float fDensity2;
+        if (bInside)
+        {
+            // We only consider the case where the ray is originating a medium close to the void (or air) 
+            // In theory, we should first determine if the current object is inside another one
+            // but that's beyond the purpose of our code.
+            fDensity2 = context::getDefaultAir().fRefractionCoef;
+        }
+        else
+        {
+            fDensity2 = currentMat.density;
+        }
+
+        // Here we take into account that the light movement is symmetrical
+        // From the observer to the source or from the source to the oberver.
+        // We then do the computation of the coefficient by taking into account
+        // the ray coming from the viewing point.
+        fCosThetaI = fabsf(fViewProjection); 
+
+        if (fCosThetaI >= 0.999f) 
+        {
+            // In this case the ray is coming parallel to the normal to the surface
+            fReflectance = (fDensity1 - fDensity2) / (fDensity1 + fDensity2);
+            fReflectance = fReflectance * fReflectance;
+            fSinThetaI = 0.0f;
+            fSinThetaT = 0.0f;
+            fCosThetaT = 1.0f;
+        }
+        else 
+        {
+            fSinThetaI = sqrtf(1 - fCosThetaI * fCosThetaI);
+            // The sign of SinThetaI has no importance, it is the same as the one of SinThetaT
+            // and they vanish in the computation of the reflection coefficient.
+            fSinThetaT = (fDensity1 / fDensity2) * fSinThetaI;
+            if (fSinThetaT * fSinThetaT > 0.9999f)
+            {
+                // Beyond that angle all surfaces are purely reflective
+                fReflectance = 1.0f ;
+                fCosThetaT = 0.0f;
+            }
+            else
+            {
+                fCosThetaT = sqrtf(1 - fSinThetaT * fSinThetaT);
+                // First we compute the reflectance in the plane orthogonal 
+                // to the plane of reflection.
+                float fReflectanceOrtho = (fDensity2 * fCosThetaT - fDensity1 * fCosThetaI ) 
+                    / (fDensity2 * fCosThetaT + fDensity1  * fCosThetaI);
+                fReflectanceOrtho = fReflectanceOrtho * fReflectanceOrtho;
+                // Then we compute the reflectance in the plane parallel to the plane of reflection
+                float fReflectanceParal = (fDensity1 * fCosThetaT - fDensity2 * fCosThetaI )
+                    / (fDensity1 * fCosThetaT + fDensity2 * fCosThetaI);
+                fReflectanceParal = fReflectanceParal * fReflectanceParal;
+
+                // The reflectance coefficient is the average of those two.
+                // If we consider a light that hasn't been previously polarized.
+                fReflectance =  0.5f * (fReflectanceOrtho + fReflectanceParal);
+            }
+        }
+    }
+    else
+    {
+        // Reflection in a metal-like material. Reflectance is equal in all directions.
+        // Note, that metal are conducting electricity and as such change the polarity of the
+        // reflected ray. But of course we ignore that..
+        fReflectance = 1.0f;
+        fCosThetaI = 1.0f;
+        fCosThetaT = 1.0f;
+    }
+}
+
+void addDirectLight(const material &currentMat, const light &currentLight, const point &ptHitPoint,
+                    const vecteur &vLightDir, const vecteur &vNormal, const vecteur &vViewDir,
+                    float fLightProjection, float fViewProjection, float coef, color &output)
+{
+    float lambert = (vLightDir * vNormal) * coef;
+    float noiseCoef = 0.0f;
+    switch(currentMat.type)
+    {
+    case material::turbulence:
+        {
+            noiseCoef = turbulenceNoise(ptHitPoint);
+            output = output +  coef * (lambert * currentLight.intensity)  
+                    * (noiseCoef * currentMat.diffuse + (1.0f - noiseCoef) * currentMat.diffuse2);
+        }
+        break;
+    case material::marble:
+        {
+        noiseCoef = marbleNoise(ptHitPoint);
+        output = output +  coef * (lambert * currentLight.intensity)  
+            * (noiseCoef * currentMat.diffuse + (1.0f - noiseCoef) * currentMat.diffuse2);
+        }
+        break;
+    default:
+        {
+        output.red += lambert * currentLight.intensity.red * currentMat.diffuse.red;
+        output.green += lambert * currentLight.intensity.green * currentMat.diffuse.green;
+        output.blue += lambert * currentLight.intensity.blue * currentMat.diffuse.blue;
+        }
+        break;
+    }
+
+    // Blinn 
+    // The direction of Blinn is exactly at mid point of the light ray 
+    // and the view ray. 
+    // We compute the Blinn vector and then we normalize it
+    // then we compute the coeficient of blinn
+    // which is the specular contribution of the current light.
+
+    vecteur blinnDir = vLightDir - vViewDir;
+    float temp = blinnDir * blinnDir;
+    if (temp != 0.0f )
+    {
+        float blinn = invsqrtf(temp) * max(fLightProjection - fViewProjection , 0.0f);
+        blinn = coef * powf(blinn, currentMat.power);
+        output += blinn *currentMat.specular  * currentLight.intensity;
+    }
+}
+
+// Everything addRay knows of a hit before its roulette
+struct surfaceHit
+{
+    point ptHitPoint;
+    // Facing the ray, bumped
+    vecteur vNormal;
+    int currentMatId;
+    bool bInside;
+    float fViewProjection;
+    // Weights of the reflection and the refraction, and the cosines of the Snell-Descartes formula
+    float fReflectance, fTransmittance, fCosThetaI, fCosThetaT;
+#ifdef RT4_PIXEL_STATS
+    // When the shading of the hit started, for the cost report
+    unsigned long long shadeStart;
+#endif
+};
+
+// First hit of the rays of a fragment when they all follow the same primary ray
+// (no depth of field). It is traced by the first ray, the others only draw
+// their roulette there, and the direct light is computed once too.
+struct primaryHitCache
+{
+    // Set once the first ray went through
+    bool bValid;
+    // The primary ray hit something that addRay can shade
+    bool bHit;
+    surfaceHit hit;
+    // Direct light of the hit, once a ray stopped there
+    bool bLight;
+    color light;
+};
+
+// Where the first ray of a fragment met the scene, for the number of lens samples
+struct lensProbe
+{
+    // Distance along the ray, 0 when it left the scene
+    float distance;
+    // The surface reflects or refracts, its roulette wants every sample
+    bool bRoulette;
+};
+
+// Nearest hit of a ray and the terms of its surface.
+// False when the ray leaves the scene, or when addRay gives up on it.
+static inline bool findSurface(const ray &viewRay, scene &myScene, const context &myContext, surfaceHit &hit)
+{
+    point ptHitPoint;
+    vecteur vNormal;
+    int currentMatId;
+    {
+        int currentBlob=-1;
+        int currentSphere=-1;
+        float t = 2000.0f;
+        for (unsigned int i = 0; i < myScene.blobContainer.size() ; ++i)
+        {
+            COST_START(testStart);
+            if (isBlobIntersected(viewRay, myScene.blobContainer[i], t)) {
+                currentBlob = i;
+            }
+            COST_TEST(blobs, i, testStart);
+        }
+        for (unsigned int i = 0; i < myScene.sphereContainer.size() ; ++i)
+        {
+            COST_START(testStart);
+            if (hitSphere(viewRay, myScene.sphereContainer[i], t))
+            {
+                currentSphere = i;
+                currentBlob = -1;
+            }
+            COST_TEST(spheres, i, testStart);
+        }
+        if (currentBlob != -1)
+        {
+            ptHitPoint  = viewRay.start + t * viewRay.dir;
+            blobInterpolation(ptHitPoint, myScene.blobContainer[currentBlob], vNormal);
+            float temp = vNormal * vNormal;
+            if (temp == 0.0f)
+                return false;
+            vNormal = invsqrtf(temp) * vNormal;
+            currentMatId = myScene.blobContainer[currentBlob].materialId;
+            COST_ADD(blobs, currentBlob, hits, 1);
+        }
+        else if (currentSphere != -1)
+        {
+            ptHitPoint  = viewRay.start + t * viewRay.dir;
+            vNormal = ptHitPoint - myScene.sphereContainer[currentSphere].pos;
+            float temp = vNormal * vNormal;
+            if (temp == 0.0f)
+                return false;
+            temp = invsqrtf(temp);
+            vNormal = temp * vNormal;
+            currentMatId = myScene.sphereContainer[currentSphere].materialId;
+            COST_ADD(spheres, currentSphere, hits, 1);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    const material &currentMat = myScene.materialContainer[currentMatId];
+    COST_START(shadeStart);
+    COST_ADD(materials, currentMatId, hits, 1);
+
+    bool bInside;
+
+    if (vNormal * viewRay.dir > 0.0f)
+    {
+        vNormal = -1.0f * vNormal;
+        bInside = true;
+    }
+    else
+    {
+        bInside = false;
+    }
+
+    if (currentMat.bump && !bumpNormal(currentMat, ptHitPoint, vNormal))
+        return false;
+
+    float fViewProjection = viewRay.dir * vNormal;
+    float fReflectance, fTransmittance;
+    float fCosThetaI, fCosThetaT;
+    fresnelTerms(currentMat, fViewProjection, bInside, myContext.fRefractionCoef, fReflectance, fCosThetaI, fCosThetaT);
+
+    fTransmittance = currentMat.refraction * (1.0f - fReflectance);
+    fReflectance = currentMat.reflection * fReflectance;
+
+    hit.ptHitPoint = ptHitPoint;
+    hit.vNormal = vNormal;
+    hit.currentMatId = currentMatId;
+    hit.bInside = bInside;
+    hit.fViewProjection = fViewProjection;
+    hit.fReflectance = fReflectance;
+    hit.fTransmittance = fTransmittance;
+    hit.fCosThetaI = fCosThetaI;
+    hit.fCosThetaT = fCosThetaT;
+#ifdef RT4_PIXEL_STATS
+    hit.shadeStart = shadeStart;
+#endif
+    return true;
+}
+
+// The "regular lighting" of a diffuse hit, with a shadow ray toward every light
+static inline void lightSurface(const surfaceHit &hit, scene &myScene, const vecteur &vViewDir, float coef, color &output)
+{
+    const material &currentMat = myScene.materialContainer[hit.currentMatId];
+    const point &ptHitPoint = hit.ptHitPoint;
+    const vecteur &vNormal = hit.vNormal;
+    ray lightRay;
+    lightRay.start = ptHitPoint;
+    for (unsigned int j = 0; j < myScene.lightContainer.size() ; ++j)
+    {
+        const light &currentLight = myScene.lightContainer[j];
+
+        lightRay.dir = currentLight.pos - ptHitPoint;
+        float fLightProjection = lightRay.dir * vNormal;
+
+        if ( fLightProjection <= 0.0f )
+            continue;
+
+        float lightDist = lightRay.dir * lightRay.dir;
+        {
+            float temp = lightDist;
+            if ( temp == 0.0f )
+                continue;
+            temp = invsqrtf(temp);
+            lightRay.dir = temp * lightRay.dir;
+            fLightProjection = temp * fLightProjection;
+        }
+
+        bool inShadow = false;
+        ++rayCounter;
+        PIXEL_STAT(shadow, 1);
+        COST_START(lightStart);
+        {
+            float t = lightDist;
+            for (unsigned int i = 0; i < myScene.sphereContainer.size() ; ++i)
+            {
+                COST_START(testStart);
+                bool bHit = hitSphere(lightRay, myScene.sphereContainer[i], t);
+                COST_TEST(spheres, i, testStart);
+                if (bHit)
+                {
+                    COST_ADD(spheres, i, hits, 1);
+                    inShadow = true;
+                    break;
+                }
+            }
+            for (unsigned int i = 0; i < myScene.blobContainer.size() ; ++i)
+            {
+                COST_START(testStart);
+                bool bHit = isBlobIntersected(lightRay, myScene.blobContainer[i], t);
+                COST_TEST(blobs, i, testStart);
+                if (bHit) {
+                    COST_ADD(blobs, i, hits, 1);
+                    inShadow = true;
+                    break;
+                }
+            }
+        }
+        COST_ADD(lights, j, shadowRays, 1);
+        COST_ADD(lights, j, occluded, inShadow ? 1 : 0);
+        COST_ADD(materials, hit.currentMatId, shadowRays, 1);
+
+        if (!inShadow && (fLightProjection > 0.0f))
+        {
+
+            addDirectLight(currentMat, currentLight, ptHitPoint, lightRay.dir, vNormal, vViewDir,
+                           fLightProjection, hit.fViewProjection, coef, output);
+        }
+        COST_ADD(lights, j, cycles, pixelStatsClock() - lightStart);
+    }
+}
+
+// addRay, whose first hit can come from the cache of its fragment,
+// and can be reported to probe
+static color tracePath(ray viewRay, scene &myScene, context myContext, primaryHitCache *cache, lensProbe *probe)
+{
+    color output = {0.0f, 0.0f, 0.0f}; 
+    float coef = 1.0f;
+    int level = 0;
+    int maxDepth = depthOverride > 0 ? depthOverride : myScene.maxDepth;
+    if (probe)
+    {
+        probe->distance = 0.0f;
+        probe->bRoulette = false;
+    }
+    do 
+    {
+        surfaceHit hit;
+        bool bCached = level == 0 && cache;
+        if (bCached)
+        {
+            if (!cache->bValid)
+            {
+                ++rayCounter;
+                cache->bHit = findSurface(viewRay, myScene, myContext, cache->hit);
+                cache->bValid = true;
+                cache->bLight = false;
+            }
+            if (!cache->bHit)
+                break;
+            hit = cache->hit;
+#ifdef RT4_PIXEL_STATS
+            hit.shadeStart = pixelStatsClock();
+#endif
+        }
+        else
+        {
+            ++rayCounter;
+            if (!findSurface(viewRay, myScene, myContext, hit))
+                break;
+        }
+        const material &currentMat = myScene.materialContainer[hit.currentMatId];
+        float fTotalWeight = hit.fReflectance + hit.fTransmittance;
+        bool bDiffuse = false;
+        if (probe && level == 0)
+        {
+            probe->distance = (hit.ptHitPoint - viewRay.start) * viewRay.dir;
+            probe->bRoulette = fTotalWeight > 0.0f;
+        }
+
+        if (fTotalWeight > 0.0f)
+        {
+            float fRoulette = sampleUnit(rouletteDimension + 2 * level);
+        
+            if (fRoulette <= hit.fReflectance)
+            {
+                coef *= currentMat.reflection;
+                PIXEL_STAT(reflection, 1);
+                COST_ADD(materials, hit.currentMatId, reflectionRays, 1);
+
+                float fReflection = - 2.0f * hit.fViewProjection;
+
+                viewRay.start = hit.ptHitPoint;
+                viewRay.dir += fReflection * hit.vNormal;
+            }
+            else if(fRoulette <= fTotalWeight)
+            {
+                coef *= currentMat.refraction;
+                PIXEL_STAT(refraction, 1);
+                COST_ADD(materials, hit.currentMatId, refractionRays, 1);
+                float fOldRefractionCoef = myContext.fRefractionCoef;
+                if (hit.bInside) 
+                {
+                    myContext.fRefractionCoef = context::getDefaultAir().fRefractionCoef;
+                }
+                else
+                {
+                    myContext.fRefractionCoef = currentMat.density;
+                }
+
+                // Here we compute the transmitted ray with the formula of Snell-Descartes
+                viewRay.start = hit.ptHitPoint;
+
+                viewRay.dir = viewRay.dir + hit.fCosThetaI * hit.vNormal;
+                viewRay.dir = (fOldRefractionCoef / myContext.fRefractionCoef) * viewRay.dir;
+                viewRay.dir += (-hit.fCosThetaT) * hit.vNormal;
+            }
+            else
+            {
+                bDiffuse = true;
+            }
+        }
+        else
+        {
+            bDiffuse = true;
+        }
+
+        if (!hit.bInside && bDiffuse)
+        {
+            if (bCached)
+            {
+                // Nothing was added before the first hit, the light is the same for every ray
+                if (!cache->bLight)
+                {
+                    color black = {0.0f, 0.0f, 0.0f};
+                    cache->light = black;
+                    lightSurface(hit, myScene, viewRay.dir, coef, cache->light);
+                    cache->bLight = true;
+                }
+                output += cache->light;
+            }
+            else
+            {
+                lightSurface(hit, myScene, viewRay.dir, coef, output);
+            }
+            coef = 0.0f ;
+        }
+        COST_ADD(materials, hit.currentMatId, cycles, pixelStatsClock() - hit.shadeStart);
+
+        level++;
+    } while ((coef > 0.0f) && (level < maxDepth));  
+
+    if (coef > 0.0f)
+    {
+        output += coef * readCubemap(myScene.cm, viewRay);
+    }
+    return output;
+}
+
+color addRay(ray viewRay, scene &myScene, context myContext)
+{
+    return tracePath(viewRay, myScene, myContext, NULL, NULL);
+}
+
+// Everything the threads share while rendering an image
+struct renderJob
+{
+    scene *myScene;
+    int width, height;
+    // Image plane units per pixel, when the image size isn't the scene size
+    float scalex, scaley;
+    // Linear colors of the four fragments of every pixel, before tonemapping
+    color *hdr;
+    // Quality of the pass, the ones of the scene unless there is a time budget
+    int complexity, maxDepth;
+    // Fragments traced by the pass, one per pixel fills the four of them
+    enum {
+        allFragments,
+        firstFragment,
+        otherFragments
+    } fragments;
+    // Added to the seeds of the rows, every pass of a time budget draws new samples
+    unsigned int seedOffset;
+    // Seed of the render (renderOptions::seed), and the sampler of the lens and the roulette
+    unsigned int seed;
+    bool bSobol;
+    // When not NULL the pass adds its samples to the fragments already there,
+    // rowSamples counts the rays per fragment of every row so far
+    int *rowSamples;
+    // Trace the rows with the wavefront engine instead of addRay,
+    // with its secondary rays sorted or not
+    bool bWavefront, bSortRays;
+    // Time of the stages of the wavefront engine, added up from all the threads
+    wavefrontTimes stageTimes;
+    mutex stageLock;
+    // Rows are no longer started after the deadline, when there is one
+    bool bDeadline;
+    chrono::steady_clock::time_point deadline;
+    // When not NULL, set to 1 for the rows traced by the pass, the calibration rows aren't
+    char *rowsTraced;
+    // Shared with the caller, see renderOptions and renderTarget
+    atomic<int> *progress;
+    const atomic<bool> *cancel;
+    float *linear;
+    bool (*rowDone)(void *user, int y);
+    void *user;
+    // Set when rowDone asked to stop
+    atomic<bool> bStopped;
+    // Largest blob of the scene, to reserve the intersection scratch space
+    size_t maxBlobCenters;
+    // Rows are handed to the threads one at a time
+    atomic<int> nextRow;
+    atomic<unsigned long long> rays;
+#ifdef RT4_PIXEL_STATS
+    // Counters of every pixel, when they were asked for
+    pixelStats *stats;
+    // Cost of every object, added up from all the threads
+    sceneCosts *costs;
+    mutex costLock;
+#endif
+};
+
+// Ray through the center of a fragment, the position is in pixels of the image.
+// With a conic perspective ptAimed is where the rays of the fragment meet,
+// on the sharp plane. False when there is no ray.
+static inline bool fragmentRay(const renderJob &job, float fragmentx, float fragmenty, ray &centerRay, point &ptAimed)
+{
+    const scene &myScene = *job.myScene;
+    // Position of the fragment on the image plane of the scene
+    float planex = fragmentx * job.scalex;
+    float planey = fragmenty * job.scaley;
+
+    if (myScene.persp.type == perspective::orthogonal)
+    {
+        ray viewRay = { {planex, planey, -10000.0f}, { 0.0f, 0.0f, 1.0f}};
+        centerRay = viewRay;
+        return true;
+    }
+    vecteur dir = {(planex - 0.5f * myScene.sizex) * myScene.persp.invProjectionDistance, 
+                (planey - 0.5f * myScene.sizey) * myScene.persp.invProjectionDistance, 
+                1.0f}; 
+
+    float norm = dir * dir;
+    if (norm == 0.0f) 
+        return false;
+    dir = invsqrtf(norm) * dir;
+    // the starting point is always the optical center of the camera
+    // we will add some perturbation later to simulate a depth of field effect
+    point start = {0.5f * myScene.sizex,  0.5f * myScene.sizey, 0.0f};
+    // The point aimed is one of the invariant of the current pixel
+    // that means that by design every ray that contribute to the current
+    // pixel must go through that point in space (on the "sharp" plane)
+    // of course the divergence is caused by the direction of the ray itself.
+    ptAimed = start + myScene.persp.clearPoint * dir;
+    ray viewRay = { {start.x, start.y, start.z}, {dir.x, dir.y, dir.z} };
+    centerRay = viewRay;
+    return true;
+}
+
+// One of the rays of a fragment, moved around the center of the lens
+// for the depth of field. False when there is no ray.
+static inline bool dispersedRay(const renderJob &job, const ray &centerRay, const point &ptAimed, ray &viewRay)
+{
+    const scene &myScene = *job.myScene;
+    viewRay = centerRay;
+    if (myScene.persp.type == perspective::orthogonal || myScene.persp.dispersion == 0.0f)
+        return true;
+    vecteur vDisturbance;                        
+    vDisturbance.x = myScene.persp.dispersion * sampleUnit(lensDimension);
+    vDisturbance.y = myScene.persp.dispersion * sampleUnit(lensDimension + 1);
+    vDisturbance.z = 0.0f;
+
+    viewRay.start = viewRay.start + vDisturbance;
+    viewRay.dir = ptAimed - viewRay.start;
+
+    float norm = viewRay.dir * viewRay.dir;
+    if (norm == 0.0f)
+        return false;
+    viewRay.dir = invsqrtf(norm) * viewRay.dir;
+    return true;
+}
+
+// Seed of the random numbers of a row
+static inline unsigned int rowSeed(const renderJob &job, int y)
+{
+    return (y + 1 + job.seedOffset) ^ (job.seed * 0x9E3779B9U);
+}
+
+// Starts the Sobol sequence of a fragment, its rays take the next points.
+// The passes of a time budget carry on with the points after the ones of the previous passes.
+static inline void startFragmentSamples(const renderJob &job, float fragmentx, float fragmenty)
+{
+    fragmentSeed = sampleSeed(unsigned(2.0f * fragmentx), unsigned(2.0f * fragmenty), job.seed);
+    fragmentSample = job.rowSamples ? job.rowSamples[int(fragmenty)] : 0;
+}
+
+// Blur, in pixels of the image, from which a fragment gets all its lens samples
+const float fullLensSamplesBlur = 2.0f;
+
+// Lens samples of a fragment whose first ray met a diffuse surface at that distance,
+// 0 when it left the scene. The rays of a fragment go through the lens and meet
+// on the sharp plane at the clear point, at distance d they spread over
+// dispersion * |1 - d / clearPoint| where a pixel is d * invProjectionDistance * scalex
+// wide. The samples are in proportion to that circle of confusion, in focus one is enough.
+// A fragment that left the scene keeps all its samples, the cubemap isn't in focus.
+static inline int lensSamples(const renderJob &job, float distance)
+{
+    if (distance <= 0.0f)
+        return job.complexity;
+    const perspective &persp = job.myScene->persp;
+    float invDistance = 1.0f / distance;
+    float invClearPoint = persp.clearPoint > 0.0f ? 1.0f / persp.clearPoint : 0.0f;
+    float blur = persp.dispersion * fabsf(invDistance - invClearPoint) / (persp.invProjectionDistance * job.scalex);
+    if (!(blur < fullLensSamplesBlur))
+        return job.complexity;
+    int samples = int(ceilf(job.complexity * blur / fullLensSamplesBlur));
+    return max(1, min(samples, job.complexity));
+}
+
+// Average of the rays traced for a fragment, the position is in pixels of the image.
+// With depth of field, the fragments in focus on a diffuse surface trace fewer lens samples.
+static inline color traceFragment(const renderJob &job, float fragmentx, float fragmenty)
+{
+    color temp = {0.0f, 0.0f, 0.0f};
+    ray centerRay;
+    point ptAimed;
+    if (!fragmentRay(job, fragmentx, fragmenty, centerRay, ptAimed))
+        return temp;
+    startFragmentSamples(job, fragmentx, fragmenty);
+    // Without depth of field the rays of the fragment share their first hit
+    const perspective &persp = job.myScene->persp;
+    bool bDepthOfField = persp.type != perspective::orthogonal && persp.dispersion != 0.0f;
+    primaryHitCache firstHit;
+    firstHit.bValid = false;
+    primaryHitCache *cache = bDepthOfField ? NULL : &firstHit;
+    // With it, the first ray tells how blurred the fragment is
+    lensProbe probe;
+    int samples = job.complexity;
+    float fTotalWeight = 0.0f;
+    for (int i = 0; i < samples; ++i, ++fragmentSample)
+    {                  
+        ray viewRay;
+        if (!dispersedRay(job, centerRay, ptAimed, viewRay))
+            break;
+        bool bProbe = bDepthOfField && i == 0 && samples > 1;
+        // The rays answered from the cache of the first hit aren't traced
+        PIXEL_STAT(primary, (cache && firstHit.bValid) ? 0 : 1);
+        color rayResult = tracePath(viewRay, *job.myScene, context::getDefaultAir(), cache, bProbe ? &probe : NULL);
+        if (bProbe && !probe.bRoulette)
+            samples = lensSamples(job, probe.distance);
+        fTotalWeight += 1.0f;
+        temp += rayResult;
+    }
+    temp = (1.0f / fTotalWeight) * temp;
+    return temp;
+}
+
+// Stores the color traced for a fragment, blended with the samples of
+// the previous passes when the pass adds up
+static inline void storeFragment(const renderJob &job, int x, int y, float fragmentx, float fragmenty,
+                                 const color &temp, float fOldWeight, float fNewWeight)
+{
+    // The fragments of a pixel are stored next to each other
+    color *fragment = job.hdr + 4 * (size_t(y) * job.width + x);
+    if (job.fragments == renderJob::firstFragment)
+    {
+        for (int i = 0; i < 4; ++i)
+            fragment[i] = fOldWeight * fragment[i] + fNewWeight * temp;
+    }
+    else
+    {
+        fragment += (fragmentx > x ? 2 : 0) + (fragmenty > y ? 1 : 0);
+        *fragment = fOldWeight * *fragment + fNewWeight * temp;
+    }
+}
+
+static void renderRow(renderJob &job, int y)
+{
+    traceScope scope("row", y);
+    // The calibration rows are drawn by the tonemapping pass
+    if (y < calibrationRows)
+        return;
+    // Every row has its own random sequence so that the image doesn't depend 
+    // on the number of threads or on the order in which rows are rendered.
+    seedRandom(rowSeed(job, y));
+    // Weights of the fragments already there and of the new rays, when the pass adds up
+    float fOldWeight = 0.0f, fNewWeight = 1.0f;
+    if (job.rowSamples)
+    {
+        fOldWeight = float(job.rowSamples[y]) / (job.rowSamples[y] + job.complexity);
+        fNewWeight = 1.0f - fOldWeight;
+    }
+    float fragmentStep = job.fragments == renderJob::firstFragment ? 1.0f : 0.5f;
+    // Everything was allocated before, the pixel loop must not touch the heap
+    beginNoAllocSection();
+    for (int x = 0 ; x < job.width; ++x)
+    {
+#ifdef RT4_PIXEL_STATS
+        resetPixelStats();
+        unsigned long long pixelStart = pixelStatsClock();
+#endif
+        for (float fragmentx = float(x) ; fragmentx < x + 1.0f; fragmentx += fragmentStep )
+        for (float fragmenty = float(y) ; fragmenty < y + 1.0f; fragmenty += fragmentStep )
+        {
+            if (job.fragments == renderJob::otherFragments && fragmentx == x && fragmenty == y)
+                continue;
+            color temp = traceFragment(job, fragmentx, fragmenty);
+            storeFragment(job, x, y, fragmentx, fragmenty, temp, fOldWeight, fNewWeight);
+        }
+#ifdef RT4_PIXEL_STATS
+        if (job.stats)
+        {
+            PIXEL_STAT(cycles, pixelStatsClock() - pixelStart);
+            job.stats[size_t(y) * job.width + x] = g_pixelStats;
+        }
+#endif
+    }
+    endNoAllocSection();
+}
+
+// Same as renderRow with the wavefront engine, the rays of all the fragments
+// of the row are traced together. sums and counts have room for the four
+// fragments of every pixel of the row.
+static void renderRowWavefront(renderJob &job, int y, wavefront &waves, color *sums, int *counts)
+{
+    traceScope scope("row", y);
+    if (y < calibrationRows)
+        return;
+    seedRandom(rowSeed(job, y));
+    float fOldWeight = 0.0f, fNewWeight = 1.0f;
+    if (job.rowSamples)
+    {
+        fOldWeight = float(job.rowSamples[y]) / (job.rowSamples[y] + job.complexity);
+        fNewWeight = 1.0f - fOldWeight;
+    }
+    float fragmentStep = job.fragments == renderJob::firstFragment ? 1.0f : 0.5f;
+    color black = {0.0f, 0.0f, 0.0f};
+    beginNoAllocSection();
+    for (int x = 0 ; x < job.width; ++x)
+    {
+        for (float fragmentx = float(x) ; fragmentx < x + 1.0f; fragmentx += fragmentStep )
+        for (float fragmenty = float(y) ; fragmenty < y + 1.0f; fragmenty += fragmentStep )
+        {
+            if (job.fragments == renderJob::otherFragments && fragmentx == x && fragmenty == y)
+                continue;
+            int slot = 4 * x + (fragmentx > x ? 2 : 0) + (fragmenty > y ? 1 : 0);
+            sums[slot] = black;
+            counts[slot] = 0;
+            ray centerRay, viewRay;
+            point ptAimed;
+            if (!fragmentRay(job, fragmentx, fragmenty, centerRay, ptAimed))
+                continue;
+            // Only the lens positions come from the sequence, the roulette of the engine
+            // doesn't follow the paths of a fragment
+            startFragmentSamples(job, fragmentx, fragmenty);
+            for (int i = 0; i < job.complexity && dispersedRay(job, centerRay, ptAimed, viewRay); ++i, ++fragmentSample)
+            {
+                waves.addPrimary(viewRay, slot);
+                ++counts[slot];
+            }
+        }
+    }
+    rayCounter += waves.trace(*job.myScene, job.maxDepth, sums);
+    for (int x = 0 ; x < job.width; ++x)
+    {
+        for (float fragmentx = float(x) ; fragmentx < x + 1.0f; fragmentx += fragmentStep )
+        for (float fragmenty = float(y) ; fragmenty < y + 1.0f; fragmenty += fragmentStep )
+        {
+            if (job.fragments == renderJob::otherFragments && fragmentx == x && fragmenty == y)
+                continue;
+            int slot = 4 * x + (fragmentx > x ? 2 : 0) + (fragmenty > y ? 1 : 0);
+            color temp = counts[slot] > 0 ? (1.0f / counts[slot]) * sums[slot] : black;
+            storeFragment(job, x, y, fragmentx, fragmenty, temp, fOldWeight, fNewWeight);
+        }
+    }
+    endNoAllocSection();
+}
+
+static void writeLinearRow(const renderJob &job, int y)
+{
+    const color *fragment = job.hdr + 4 * size_t(y) * job.width;
+    float *pixel = job.linear + 3 * size_t(y) * job.width;
+    for (int x = 0; x < job.width; ++x, fragment += 4, pixel += 3)
+    {
+        color sum = fragment[0] + fragment[1] + fragment[2] + fragment[3];
+        pixel[0] = 0.25f * sum.red;
+        pixel[1] = 0.25f * sum.green;
+        pixel[2] = 0.25f * sum.blue;
+    }
+}
+
+static void renderRows(renderJob *job)
+{
+    traceScope scope("renderRows");
+    rayCounter = 0;
+    depthOverride = job->maxDepth != job->myScene->maxDepth ? job->maxDepth : 0;
+    bSobolSampling = job->bSobol;
+    reserveBlobScratch(job->maxBlobCenters);
+    // Queues of the wavefront engine, for a row at most
+    wavefront waves;
+    vector<color> sums;
+    vector<int> counts;
+    if (job->bWavefront)
+    {
+        waves.bSortRays = job->bSortRays;
+        waves.reserve(4 * size_t(job->width) * job->complexity, job->myScene->lightContainer.size());
+        sums.resize(4 * size_t(job->width));
+        counts.resize(4 * size_t(job->width));
+    }
+#ifdef RT4_PIXEL_STATS
+    if (job->costs)
+    {
+        g_sceneCosts.reset(*job->myScene);
+        g_sceneCosts.bEnabled = true;
+    }
+#endif
+    for (int y = job->nextRow++; y < job->height; y = job->nextRow++)
+    {
+        if ((job->cancel && *job->cancel) || job->bStopped)
+            break;
+        if (job->bDeadline && chrono::steady_clock::now() >= job->deadline)
+            break;
+        if (job->bWavefront)
+            renderRowWavefront(*job, y, waves, &sums[0], &counts[0]);
+        else
+            renderRow(*job, y);
+        if (job->rowSamples)
+            job->rowSamples[y] += job->complexity;
+        if (job->rowsTraced && y >= calibrationRows)
+            job->rowsTraced[y] = 1;
+        if (job->linear)
+            writeLinearRow(*job, y);
+        if (job->progress)
+            ++*job->progress;
+        if (job->rowDone && !job->rowDone(job->user, y))
+            job->bStopped = true;
+    }
+    job->rays += rayCounter;
+    depthOverride = 0;
+    if (job->bWavefront)
+    {
+        lock_guard<mutex> guard(job->stageLock);
+        job->stageTimes.add(waves.times);
+    }
+#ifdef RT4_PIXEL_STATS
+    if (job->costs)
+    {
+        g_sceneCosts.bEnabled = false;
+        lock_guard<mutex> guard(job->costLock);
+        job->costs->add(g_sceneCosts);
+    }
+#endif
+}
+
+static void renderThread(void (*rows)(renderJob *), renderJob *job)
+{
+    traceThreadName("render");
+    rows(job);
+}
+
+// Shares the rows of the image between the threads,
+// the calling thread takes its share too
+static void runPass(renderJob &job, int nbThreads, void (*rows)(renderJob *))
+{
+    job.nextRow = 0;
+    vector<thread> threads;
+    for (int i = 1; i < nbThreads; ++i)
+    {
+        threads.push_back(thread(renderThread, rows, &job));
+    }
+    rows(&job);
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+}
+
+int renderWidth(const scene &myScene, const renderOptions &options)
+{
+    return options.width > 0 ? options.width : myScene.sizex;
+}
+
+int renderHeight(const scene &myScene, const renderOptions &options)
+{
+    return options.height > 0 ? options.height : myScene.sizey;
+}
+
+// Share of a time budget for the tracing, exposure, tonemapping and writing take the rest
+const float budgetTraceShare = 0.9f;
+
+// A single pass at the quality of the scene, without anything shared with a caller
+static void initJob(renderJob &job, scene &myScene, int width, int height)
+{
+    job.myScene = &myScene;
+    job.width = width;
+    job.height = height;
+    job.scalex = float(myScene.sizex) / job.width;
+    job.scaley = float(myScene.sizey) / job.height;
+    job.maxBlobCenters = 0;
+    for (size_t i = 0; i < myScene.blobContainer.size(); ++i)
+        job.maxBlobCenters = max(job.maxBlobCenters, myScene.blobContainer[i].centerList.size());
+    job.complexity = myScene.complexity;
+    job.maxDepth = myScene.maxDepth;
+    job.fragments = renderJob::allFragments;
+    job.seedOffset = 0;
+    job.seed = 0;
+    job.bSobol = false;
+    job.rowSamples = NULL;
+    job.bWavefront = false;
+    job.bSortRays = false;
+    wavefrontTimes zero = {0.0, 0.0, 0.0, 0.0, 0.0};
+    job.stageTimes = zero;
+    job.bDeadline = false;
+    job.rowsTraced = NULL;
+    job.rays = 0;
+    job.progress = NULL;
+    job.cancel = NULL;
+    job.linear = NULL;
+    job.rowDone = NULL;
+    job.user = NULL;
+    job.bStopped = false;
+#ifdef RT4_PIXEL_STATS
+    job.stats = NULL;
+    job.costs = NULL;
+#endif
+}
+
+// Seconds per ray of a single fragment pixel, at that depth. It is measured
+// on an image with a sixteenth of the traced pixels.
+static double probeCost(scene &myScene, int width, int height, int maxDepth, int nbThreads)
+{
+    traceScope scope("probe", maxDepth);
+    renderJob probe;
+    int tracedRows = max(1, (height - calibrationRows) / 4);
+    initJob(probe, myScene, max(1, width / 4), calibrationRows + tracedRows);
+    probe.complexity = 1;
+    probe.maxDepth = maxDepth;
+    probe.fragments = renderJob::firstFragment;
+    color black = {0.0f, 0.0f, 0.0f};
+    vector<color> hdr(4 * size_t(probe.width) * probe.height, black);
+    probe.hdr = &hdr[0];
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    runPass(probe, min(nbThreads, tracedRows), renderRows);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return seconds / (double(probe.width) * tracedRows);
+}
+
+// Fits the render in the time left until the deadline. The probes choose the depth,
+// the largest one that fits with four fragments per pixel or else with one.
+// The first pass traces one fragment per pixel and is never cut short, the image
+// can't be any worse. The next one traces the three other fragments of every pixel
+// and the following ones add rays to them, up to the complexity of the scene.
+// The deadline stops them between two rows, the rows they didn't reach keep their
+// fragments of the previous passes.
+static void renderWithBudget(renderJob &job, int nbThreads, chrono::steady_clock::time_point deadline,
+                             budgetReport &report)
+{
+    scene &myScene = *job.myScene;
+    int tracedRows = job.height - calibrationRows;
+    double tracedPixels = double(job.width) * tracedRows;
+    int depths[3] = {myScene.maxDepth, min(4, myScene.maxDepth), min(2, myScene.maxDepth)};
+    double depthCosts[3] = {0.0, 0.0, 0.0};
+    int depth = depths[2], expectedFragments = 1;
+    double expectedRays = 1.0;
+    bool bFound = false;
+    for (int nbFragments = 4; nbFragments >= 1 && !bFound; nbFragments -= 3)
+    {
+        for (int i = 0; i < 3 && !bFound; ++i)
+        {
+            // Scenes with few bounces have the same depth more than once
+            for (int j = 0; j < i && depthCosts[i] == 0.0; ++j)
+            {
+                if (depths[j] == depths[i])
+                    depthCosts[i] = depthCosts[j];
+            }
+            if (depthCosts[i] == 0.0)
+                depthCosts[i] = probeCost(myScene, job.width, job.height, depths[i], nbThreads);
+            double seconds = chrono::duration<double>(deadline - chrono::steady_clock::now()).count();
+            double raysFitting = seconds / (tracedPixels * nbFragments * depthCosts[i]);
+            if (raysFitting >= 1.0)
+            {
+                depth = depths[i];
+                expectedFragments = nbFragments;
+                expectedRays = min(raysFitting, double(myScene.complexity));
+                bFound = true;
+            }
+        }
+    }
+
+    // Rays per fragment of every row, and whether its pixels have four fragments
+    vector<int> samples(job.height, 0);
+    vector<char> fullRows(job.height, 0);
+    int passes = 0;
+    job.complexity = 1;
+    job.maxDepth = depth;
+    job.deadline = deadline;
+    {
+        traceScope scope("pass", passes);
+        job.fragments = renderJob::firstFragment;
+        job.bDeadline = false;
+        runPass(job, nbThreads, renderRows);
+        ++passes;
+    }
+    for (int y = calibrationRows; y < job.height; ++y)
+        samples[y] = 1;
+    if (chrono::steady_clock::now() < deadline && !job.bStopped && !(job.cancel && *job.cancel))
+    {
+        traceScope scope("pass", passes);
+        job.fragments = renderJob::otherFragments;
+        job.bDeadline = true;
+        job.seedOffset = passes * job.height;
+        // The threads see the deadline at different times, the rows done
+        // aren't always the first ones
+        job.rowsTraced = &fullRows[0];
+        runPass(job, nbThreads, renderRows);
+        job.rowsTraced = NULL;
+        ++passes;
+    }
+    if (find(fullRows.begin() + calibrationRows, fullRows.end(), 0) == fullRows.end())
+    {
+        // Every pixel has its four fragments, the next passes add rays to them
+        job.fragments = renderJob::allFragments;
+        job.rowSamples = &samples[0];
+        while (*min_element(samples.begin() + calibrationRows, samples.end()) < myScene.complexity &&
+               chrono::steady_clock::now() < deadline && !job.bStopped && !(job.cancel && *job.cancel))
+        {
+            traceScope scope("pass", passes);
+            job.seedOffset = passes * job.height;
+            runPass(job, nbThreads, renderRows);
+            ++passes;
+        }
+        job.rowSamples = NULL;
+    }
+
+    double totalRays = 0.0;
+    float fMinRays = 0.0f;
+    bool bAllFull = true;
+    for (int y = calibrationRows; y < job.height; ++y)
+    {
+        float fRowRays = float((fullRows[y] ? 4 : 1) * samples[y]);
+        totalRays += fRowRays;
+        fMinRays = (y == calibrationRows) ? fRowRays : min(fMinRays, fRowRays);
+        bAllFull = bAllFull && fullRows[y];
+    }
+    report.fSamples = float(totalRays / tracedRows);
+    report.fMinSamples = fMinRays;
+    report.fragments = bAllFull ? 4 : 1;
+    report.maxDepth = depth;
+    report.fExpectedSamples = float(expectedFragments * expectedRays);
+    report.passes = passes;
+    report.bComplete = bAllFull && depth == myScene.maxDepth && 
+                       *min_element(samples.begin() + calibrationRows, samples.end()) >= myScene.complexity;
+}
+
+// Cost of one pixel traced for an estimate
+struct pixelSample
+{
+    double seconds, rays;
+#ifdef RT4_PIXEL_STATS
+    pixelStats stats;
+#endif
+};
+
+// Extrapolates a value of the pixels to the whole image. The strata have two samples
+// each, their difference gives the variance inside the stratum.
+static void stratifiedTotal(const vector<pixelSample> &samples, const vector<double> &stratumPixels,
+                            double (*value)(const pixelSample &), double &total, double &error)
+{
+    double variance = 0.0;
+    total = 0.0;
+    for (size_t i = 0; i < stratumPixels.size(); ++i)
+    {
+        double a = value(samples[2 * i]), b = value(samples[2 * i + 1]);
+        total += stratumPixels[i] * 0.5 * (a + b);
+        // Variance of the mean of two samples, (a - b)^2 / 2 for each of them
+        variance += stratumPixels[i] * stratumPixels[i] * 0.25 * (a - b) * (a - b);
+    }
+    error = 1.96 * sqrt(variance);
+}
+
+static double sampleSeconds(const pixelSample &sample) { return sample.seconds; }
+static double sampleRays(const pixelSample &sample) { return sample.rays; }
+
+void estimateRender(scene &myScene, const renderOptions &options, double probeSeconds, renderEstimate &estimate)
+{
+    traceScope scope("estimate");
+    renderJob job;
+    initJob(job, myScene, renderWidth(myScene, options), renderHeight(myScene, options));
+    job.seed = options.seed;
+    job.bSobol = options.bSobol;
+    int tracedRows = max(0, job.height - calibrationRows);
+    double tracedPixels = double(job.width) * tracedRows;
+    memset(&estimate, 0, sizeof(estimate));
+    estimate.width = job.width;
+    estimate.height = job.height;
+
+    rayCounter = 0;
+    bSobolSampling = job.bSobol;
+    reserveBlobScratch(job.maxBlobCenters);
+    vector<pixelSample> samples, levelSamples;
+    vector<double> stratumPixels, levelPixels;
+    vector<int> pixels;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    // Every level has four times the strata of the previous one, the last one
+    // finished in time is the one used. The first one is always finished.
+    for (int grid = 4; tracedRows > 0; grid *= 2)
+    {
+        int columns = min(grid, job.width), rows = min(grid, tracedRows);
+        if (!samples.empty() && 2.0 * columns * rows > tracedPixels / 8)
+            break;
+        // The pixels are drawn before tracing, addRay uses the same random numbers
+        seedRandom(0x5EED + grid);
+        pixels.clear();
+        levelPixels.clear();
+        for (int j = 0; j < rows; ++j)
+        for (int i = 0; i < columns; ++i)
+        {
+            int x0 = job.width * i / columns, x1 = job.width * (i + 1) / columns;
+            int y0 = calibrationRows + tracedRows * j / rows, y1 = calibrationRows + tracedRows * (j + 1) / rows;
+            levelPixels.push_back(double(x1 - x0) * (y1 - y0));
+            for (int n = 0; n < 2; ++n)
+            {
+                pixels.push_back(min(x1 - 1, x0 + int(randomUnit() * (x1 - x0))));
+                pixels.push_back(min(y1 - 1, y0 + int(randomUnit() * (y1 - y0))));
+            }
+        }
+        levelSamples.resize(pixels.size() / 2);
+        bool bFinished = true;
+        for (size_t n = 0; n < levelSamples.size(); ++n)
+        {
+            if (!samples.empty() && chrono::duration<double>(chrono::steady_clock::now() - start).count() > probeSeconds)
+            {
+                bFinished = false;
+                break;
+            }
+            int x = pixels[2 * n], y = pixels[2 * n + 1];
+            seedRandom(rowSeed(job, y));
+            unsigned long long raysBefore = rayCounter;
+#ifdef RT4_PIXEL_STATS
+            resetPixelStats();
+#endif
+            chrono::steady_clock::time_point pixelStart = chrono::steady_clock::now();
+            for (float fragmentx = float(x) ; fragmentx < x + 1.0f; fragmentx += 0.5f )
+            for (float fragmenty = float(y) ; fragmenty < y + 1.0f; fragmenty += 0.5f )
+                traceFragment(job, fragmentx, fragmenty);
+            levelSamples[n].seconds = chrono::duration<double>(chrono::steady_clock::now() - pixelStart).count();
+            levelSamples[n].rays = double(rayCounter - raysBefore);
+#ifdef RT4_PIXEL_STATS
+            levelSamples[n].stats = g_pixelStats;
+#endif
+        }
+        if (!bFinished)
+            break;
+        samples.swap(levelSamples);
+        stratumPixels.swap(levelPixels);
+    }
+    estimate.probeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    estimate.sampledPixels = int(samples.size());
+    estimate.strata = int(stratumPixels.size());
+    stratifiedTotal(samples, stratumPixels, sampleSeconds, estimate.seconds, estimate.secondsError);
+    stratifiedTotal(samples, stratumPixels, sampleRays, estimate.rays, estimate.raysError);
+#ifdef RT4_PIXEL_STATS
+    double counters[pixelStats::counterCount] = {};
+    for (size_t i = 0; i < stratumPixels.size(); ++i)
+    {
+        for (int c = 0; c < pixelStats::counterCount; ++c)
+            counters[c] += stratumPixels[i] * 0.5 * (samples[2 * i].stats.counters[c] + samples[2 * i + 1].stats.counters[c]);
+    }
+    estimate.bCounters = true;
+    estimate.primaryRays = counters[pixelStats::primary];
+    estimate.reflectionRays = counters[pixelStats::reflection];
+    estimate.refractionRays = counters[pixelStats::refraction];
+    estimate.shadowRays = counters[pixelStats::shadow];
+    estimate.blobTests = counters[pixelStats::blobTests];
+    estimate.noiseCalls = counters[pixelStats::noise];
+#endif
+
+    // Everything that stays loaded during the render
+    estimate.sceneBytes = double(myScene.materialContainer.size() * sizeof(material) +
+                                 myScene.sphereContainer.size() * sizeof(sphere) +
+                                 myScene.blobContainer.size() * sizeof(blob) +
+                                 myScene.lightContainer.size() * sizeof(light)) +
+                          6.0 * myScene.cm.sizeX * myScene.cm.sizeY * sizeof(color);
+    for (size_t i = 0; i < myScene.blobContainer.size(); ++i)
+        estimate.sceneBytes += double(myScene.blobContainer[i].centerList.size() * sizeof(point));
+    for (size_t i = 0; i < myScene.animation.size(); ++i)
+        estimate.sceneBytes += double(sizeof(animationTrack) + myScene.animation[i].keys.size() * sizeof(keyframe));
+    // The fragments stay until the end, the luminances of the exposure and the pixels
+    // of the tonemapping come one after the other
+    double pixelCount = double(job.width) * job.height;
+    double luminanceBytes = myScene.tonemap.fOutliers > 0.0f ? 4.0 * tracedPixels * sizeof(float) : 0.0;
+    estimate.imageBytes = 4.0 * pixelCount * sizeof(color) + max(luminanceBytes, 3.0 * pixelCount);
+#ifdef RT4_PIXEL_STATS
+    if (options.statsPrefix)
+        estimate.imageBytes += pixelCount * sizeof(pixelStats);
+#endif
+}
+
+bool renderImage(scene &myScene, const renderOptions &options, const renderTarget &target)
+{
+    renderJob job;
+    initJob(job, myScene, renderWidth(myScene, options), renderHeight(myScene, options));
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    job.bWavefront = options.bWavefront;
+    job.bSortRays = options.bSortRays;
+    job.seed = options.seed;
+    job.bSobol = options.bSobol;
+    job.progress = options.progress;
+    job.cancel = options.cancel;
+    job.linear = target.linear;
+    job.rowDone = target.rowDone;
+    job.user = target.user;
+    if (job.linear)
+    {
+        // The calibration rows aren't traced
+        fill(job.linear, job.linear + 3 * size_t(job.width) * min(job.height, calibrationRows), 0.0f);
+    }
+    // The calibration rows keep black fragments
+    color black = {0.0f, 0.0f, 0.0f};
+    vector<color> hdr(4 * size_t(job.width) * job.height, black);
+    job.hdr = &hdr[0];
+#ifdef RT4_PIXEL_STATS
+    // The calibration rows are left at zero
+    vector<pixelStats> stats;
+    if (options.statsPrefix)
+    {
+        pixelStats zero = {};
+        stats.assign(size_t(job.width) * job.height, zero);
+        job.stats = &stats[0];
+    }
+    sceneCosts costs;
+    if (options.costReportName)
+    {
+        costs.reset(myScene);
+        job.costs = &costs;
+    }
+#endif
+
+    int nbThreads = options.threads;
+    if (nbThreads <= 0)
+        nbThreads = max(1, int(thread::hardware_concurrency()));
+    nbThreads = min(nbThreads, job.height);
+    bool bBudget = options.timeBudget > 0.0f && job.height > calibrationRows;
+    if (bBudget)
+    {
+        traceScope scope("render");
+        // The rows are traced more than once, their linear pixels wait for the last pass
+        job.linear = NULL;
+        budgetReport report;
+        chrono::steady_clock::time_point deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(budgetTraceShare * options.timeBudget));
+        renderWithBudget(job, nbThreads, deadline, report);
+        job.linear = target.linear;
+        if (job.linear)
+        {
+            for (int y = calibrationRows; y < job.height; ++y)
+                writeLinearRow(job, y);
+        }
+        if (options.budget)
+            *options.budget = report;
+    }
+    else
+    {
+        traceScope scope("render");
+        runPass(job, nbThreads, renderRows);
+    }
+    if ((options.cancel && *options.cancel) || job.bStopped)
+        return false;
+    hdrImage hdrFragments = {job.width, job.height, job.hdr};
+    if (target.pixels)
+    {
+        float exposure;
+        {
+            traceScope scope("exposure");
+            exposure = computeExposure(hdrFragments, myScene.tonemap, nbThreads);
+            if (options.animationExposure)
+            {
+                // The exposure of an animation eases toward the one of the new frame,
+                // in stops, so that a bright object passing by doesn't make it flicker
+                float previous = *options.animationExposure;
+                if (previous > 0.0f && exposure > 0.0f)
+                    exposure = expf(myScene.tonemap.fSmoothing * logf(previous) + (1.0f - myScene.tonemap.fSmoothing) * logf(exposure));
+                *options.animationExposure = exposure;
+            }
+        }
+        {
+            traceScope scope("tonemap");
+            tonemapImage(hdrFragments, myScene.tonemap, exposure, target.pixels, nbThreads);
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    if (options.bStats)
+    {
+        cout << "Rendered " << job.width << "x" << job.height << " with " << nbThreads 
+             << " threads in " << seconds << " s, " << job.rays << " rays, " 
+             << job.rays * 1e-6 / seconds << " Mrays/s" << endl;
+        if (job.bWavefront)
+        {
+            const wavefrontTimes &times = job.stageTimes;
+            cout << "Wavefront stages (s, all threads) : extend " << times.extend << ", shade " << times.shade 
+                 << ", shadow " << times.shadow << ", miss " << times.miss << ", sort " << times.sort << endl;
+        }
+    }
+
+    traceScope scope("write");
+#ifdef RT4_PIXEL_STATS
+    if (job.stats && !writePixelStats(options.statsPrefix, job.stats, job.width, job.height))
+        return false;
+    if (job.costs && !writeCostReport(options.costReportName, myScene, costs))
+        return false;
+#endif
+    if (options.hdrName && !writeHdrImage(options.hdrName, hdrFragments))
+        return false;
+    return true;
+}
+
+bool draw(char* outputName, scene &myScene, const renderOptions &options)
+{
+    int width = renderWidth(myScene, options);
+    int height = renderHeight(myScene, options);
+    ofstream imageFile(outputName,ios_base::binary);
+    if (!imageFile)
+        return false;
+    // Addition of the TGA header
+    imageFile.put(0).put(0);
+    imageFile.put(2);        /* RGB not compressed */
+
+    imageFile.put(0).put(0);
+    imageFile.put(0).put(0);
+    imageFile.put(0);
+
+    imageFile.put(0).put(0); /* origin X */ 
+    imageFile.put(0).put(0); /* origin Y */
+
+    imageFile.put((unsigned char)(width & 0x00FF)).put((unsigned char)((width & 0xFF00) / 256));
+    imageFile.put((unsigned char)(height & 0x00FF)).put((unsigned char)((height & 0xFF00) / 256));
+    imageFile.put(24);                 /* 24 bit bitmap */
+    imageFile.put(0);
+    // end of the TGA header 
+
+    vector<unsigned char> image(3 * size_t(width) * height);
+    renderTarget target;
+    target.pixels = &image[0];
+    if (!renderImage(myScene, options, target))
+        return false;
+    traceScope scope("write");
+    imageFile.write((const char *)&image[0], image.size());
+    return bool(imageFile);
+}
@@ -1,45 +1,180 @@
-/*
-    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
-    It is free to use for educational purpose and cannot be redistributed
-    outside of the tutorial pages.
-    Any further inquiry :
-    mailto:info@codermind.com
- */
-
-#ifndef __RAYTRACE_H
-#define __RAYTRACE_H
-
-#include "Def.h"
-#include "Texture.h"
-#include "Cubemap.h"
-
-struct material {
-    enum {
-        gouraud=0,
-        noise=1,
-        marble=2,
-        turbulence=3
-    } type;
-
-    color diffuse;
-    //Second diffuse color, optional for the procedural materials
-    color diffuse2; 
-    float bump, reflection, refraction, density;
-    color specular;
-    float power;
-};
-
-struct sphere {
-	point pos;
-	float size;
-	int materialId;
-};
-
-struct light {
-	point pos;
-	color intensity;
-};
-
-#define invsqrtf(x) (1.0f / sqrtf(x))
-
-#endif // __RAYTRACE_H
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __RAYTRACE_H
+#define __RAYTRACE_H
+
+#include <atomic>
+#include "Def.h"
+#include "Texture.h"
+#include "Cubemap.h"
+
+struct material {
+    enum {
+        gouraud=0,
+        noise=1,
+        marble=2,
+        turbulence=3
+    } type;
+
+    color diffuse;
+    //Second diffuse color, optional for the procedural materials
+    color diffuse2; 
+    float bump, reflection, refraction, density;
+    color specular;
+    float power;
+};
+
+struct sphere {
+	point pos;
+	float size;
+	int materialId;
+};
+
+struct light {
+	point pos;
+	color intensity;
+};
+
+#define invsqrtf(x) (1.0f / sqrtf(x))
+
+struct ray;
+struct scene;
+struct context;
+
+bool hitSphere(const ray &r, const sphere& s, float &t);
+
+// Noise coefficients of the procedural materials at a given point
+float turbulenceNoise(const point &p);
+float marbleNoise(const point &p);
+
+// Color seen along a ray, followed for up to MaxDepth bounces of the scene
+color addRay(ray viewRay, scene &myScene, context myContext);
+
+// Pieces of the shading of addRay, shared with the wavefront engine (Wavefront.h).
+// Perturbs the normal of a bumpy material, false when nothing is left of it.
+bool bumpNormal(const material &currentMat, const point &ptHitPoint, vecteur &vNormal);
+// Share of the light reflected by the surface, and the cosines of the incident
+// and transmitted rays, for a ray coming from a medium of index fRefractionCoef
+void fresnelTerms(const material &currentMat, float fViewProjection, bool bInside, float fRefractionCoef,
+                  float &fReflectance, float &fCosThetaI, float &fCosThetaT);
+// Diffuse and specular light of a visible light, added to output
+void addDirectLight(const material &currentMat, const light &currentLight, const point &ptHitPoint,
+                    const vecteur &vLightDir, const vecteur &vNormal, const vecteur &vViewDir,
+                    float fLightProjection, float fViewProjection, float coef, color &output);
+
+// Per thread random numbers in [0, 1], used instead of rand() while rendering
+void seedRandom(unsigned int seed);
+float randomUnit();
+
+// Quality reached by a render with a time budget
+struct budgetReport {
+    // Rays per pixel (fragments times rays per fragment), on average and in the worst row
+    float fSamples, fMinSamples;
+    // Fragments of every pixel (4, or 1 when some rows have a single one)
+    // and bounces of the rays
+    int fragments, maxDepth;
+    // Rays per pixel that the probes expected to fit
+    float fExpectedSamples;
+    // Passes over the image, the preview included
+    int passes;
+    // The quality of the scene was reached, the image doesn't need any refinement
+    bool bComplete;
+};
+
+// Cost of a render, extrapolated from a sample of its pixels
+struct renderEstimate {
+    int width, height;
+    // Pixels traced for the estimate, two in each stratum, and the time it took
+    int sampledPixels, strata;
+    double probeSeconds;
+    // Totals of the image on a single thread, with the half width
+    // of their 95% confidence interval
+    double seconds, secondsError;
+    double rays, raysError;
+    // Totals of the counters of the pixel stats, only in builds with RT4_PIXEL_STATS
+    bool bCounters;
+    double primaryRays, reflectionRays, refractionRays, shadowRays, blobTests, noiseCalls;
+    // Memory of the scene and of the image buffers at their largest, during the exposure
+    // or the tonemapping
+    double sceneBytes, imageBytes;
+};
+
+// Settings of a render that aren't part of the scene description
+struct renderOptions {
+    // Number of rendering threads, 0 for one per hardware thread
+    int threads;
+    // Size of the output image, 0 for the size of the scene.
+    // The view doesn't change, only the number of pixels that cover it.
+    int width, height;
+    // Print the render time and the number of rays traced
+    bool bStats;
+    // Where to write the per pixel cost heatmaps, only in builds with RT4_PIXEL_STATS
+    const char *statsPrefix;
+    // Where to write the cost of each object, material and light, same builds only
+    const char *costReportName;
+    // Where to write the linear fragments before tonemapping (PFM or OpenEXR)
+    const char *hdrName;
+    // Exposure carried from one frame of an animation to the next, NULL for a still image
+    float *animationExposure;
+    // Rows rendered so far, for the callers following a render from another thread.
+    // With a time budget the rows are rendered, and counted, once per pass.
+    std::atomic<int> *progress;
+    // Set from another thread to stop the render, draw then fails
+    const std::atomic<bool> *cancel;
+    // Seconds the render may take, 0 for no limit. The scene loading isn't counted.
+    // The quality is lowered to fit and the image is refined until the deadline.
+    float timeBudget;
+    // What the time budget allowed, can be NULL
+    budgetReport *budget;
+    // Trace breadth first with the wavefront engine (Wavefront.h), a row at a time.
+    // It doesn't fill the pixel stats nor the cost report.
+    bool bWavefront;
+    // Sort the secondary rays of the wavefront engine by direction and origin before tracing them
+    bool bSortRays;
+    // Draw the lens positions and the reflection or refraction choices from an Owen scrambled
+    // Sobol sequence per fragment (Sampler.h). The wavefront engine only draws the lens positions.
+    bool bSobol;
+    // Renders with different seeds have independent noise
+    unsigned int seed;
+    renderOptions() : threads(0), width(0), height(0), bStats(false), statsPrefix(0), costReportName(0), 
+                      hdrName(0), animationExposure(0), progress(0), cancel(0), timeBudget(0.0f), budget(0),
+                      bWavefront(false), bSortRays(false), bSobol(false), seed(0) {}
+};
+
+// Where renderImage puts the image, the buffers are width * height pixels
+// in the order of the rows of the TGA files. Any of them can be NULL.
+struct renderTarget {
+    // 24 bits BGR pixels after tonemapping, calibration rows included
+    unsigned char *pixels;
+    // Linear RGB pixels before the exposure, the average of their four fragments.
+    // The calibration rows are left black.
+    float *linear;
+    // Called by the rendering threads once a row is traced, its linear pixels
+    // are ready then (at the end only with a time budget). Returning false stops the render.
+    bool (*rowDone)(void *user, int y);
+    void *user;
+    renderTarget() : pixels(0), linear(0), rowDone(0), user(0) {}
+};
+
+// Renders into memory. Fails when the render is stopped or an output
+// file of the options can't be written.
+bool renderImage(scene &myScene, const renderOptions &options, const renderTarget &target);
+
+// Renders to a TGA file
+bool draw(char* outputName, scene &myScene, const renderOptions &options);
+
+// Traces a stratified sample of the pixels of the image, finer and finer
+// for about probeSeconds, and extrapolates the cost of the whole render
+void estimateRender(scene &myScene, const renderOptions &options, double probeSeconds, renderEstimate &estimate);
+
+// Size of the image rendered with those options
+int renderWidth(const scene &myScene, const renderOptions &options);
+int renderHeight(const scene &myScene, const renderOptions &options);
+
+#endif // __RAYTRACE_H
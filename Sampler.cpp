@@ -0,0 +1,100 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "Sampler.h"
+
+// Generator matrices of the first two dimensions of the Sobol sequence, one column
+// per bit of the index. The first is the van der Corput sequence, the bits of
+// the index in reverse order, the second one the Pascal matrix modulo 2.
+// The products are kept for every byte of the index, four lookups make a point.
+struct sobolMatrices
+{
+    unsigned int bytes[2][4][256];
+    sobolMatrices()
+    {
+        unsigned int columns[2][32];
+        unsigned int pascal = 0x80000000U;
+        for (int bit = 0; bit < 32; ++bit)
+        {
+            columns[0][bit] = 0x80000000U >> bit;
+            columns[1][bit] = pascal;
+            pascal ^= pascal >> 1;
+        }
+        for (int dimension = 0; dimension < 2; ++dimension)
+        for (int byte = 0; byte < 4; ++byte)
+        for (int value = 0; value < 256; ++value)
+        {
+            unsigned int x = 0;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                if (value & (1 << bit))
+                    x ^= columns[dimension][8 * byte + bit];
+            }
+            bytes[dimension][byte][value] = x;
+        }
+    }
+};
+
+static const sobolMatrices sobol;
+
+static inline unsigned int hashValue(unsigned int x)
+{
+    x ^= x >> 16;
+    x *= 0x85EBCA6BU;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35U;
+    x ^= x >> 16;
+    return x;
+}
+
+static inline unsigned int hashCombine(unsigned int seed, unsigned int value)
+{
+    return hashValue(seed ^ (value * 0x9E3779B9U));
+}
+
+static inline unsigned int reverseBits(unsigned int x)
+{
+    x = ((x >> 1) & 0x55555555U) | ((x & 0x55555555U) << 1);
+    x = ((x >> 2) & 0x33333333U) | ((x & 0x33333333U) << 2);
+    x = ((x >> 4) & 0x0F0F0F0FU) | ((x & 0x0F0F0F0FU) << 4);
+    x = ((x >> 8) & 0x00FF00FFU) | ((x & 0x00FF00FFU) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Random permutation of the integers where every bit only depends on the bits below it
+// (Laine and Karras 2011, with the constants of Burley 2020). On the reversed bits
+// it is a nested uniform scrambling, the Owen scrambling of the binary digits.
+static inline unsigned int owenScramble(unsigned int x, unsigned int seed)
+{
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6C50B47CU;
+    x ^= x * 0xB82F1E52U;
+    x ^= x * 0xC7AFE638U;
+    x ^= x * 0x8D22F6E6U;
+    return reverseBits(x);
+}
+
+unsigned int sampleSeed(unsigned int x, unsigned int y, unsigned int seed)
+{
+    return hashCombine(hashCombine(hashValue(seed), x + 1), y + 1);
+}
+
+float sobolSample(unsigned int index, unsigned int dimension, unsigned int seed)
+{
+    // Both dimensions of a pair take the same point of the sequence,
+    // the other pairs take other ones
+    unsigned int pairSeed = hashCombine(seed, dimension >> 1);
+    index = owenScramble(index, pairSeed);
+    const unsigned int (*bytes)[256] = sobol.bytes[dimension & 1];
+    unsigned int x = bytes[0][index & 0xFF] ^ bytes[1][(index >> 8) & 0xFF] ^
+                     bytes[2][(index >> 16) & 0xFF] ^ bytes[3][index >> 24];
+    x = owenScramble(x, hashCombine(pairSeed, (dimension & 1) + 1));
+    // The 24 bits of a float, 1 can't be reached
+    return float(x >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,29 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __SAMPLER_H
+#define __SAMPLER_H
+
+// Low discrepancy sequences for the lens positions and the roulette of the rays (rt4 --sobol).
+// Independent random numbers leave clusters and holes between the rays of a fragment,
+// the noise only goes down with the square root of their number. The points of a
+// Sobol sequence fill the unit square evenly, whatever the number of them taken from
+// its start, and the noise goes down faster on the smooth parts of the image.
+// Every fragment has its own sequence : the Sobol points are shuffled and their
+// digits scrambled (Owen scrambling, with the hash of Burley 2020), from a seed,
+// so that the neighbouring fragments don't repeat the same pattern.
+// The dimensions go in pairs, the two dimensions of a pair are stratified together
+// and the pairs are shuffled independently of each other.
+
+// Seed of the sequence of a fragment, from its position and the seed of the render
+unsigned int sampleSeed(unsigned int x, unsigned int y, unsigned int seed);
+
+// Number in [0, 1) of a dimension for the point at index of the sequence of that seed
+float sobolSample(unsigned int index, unsigned int dimension, unsigned int seed);
+
+#endif // __SAMPLER_H
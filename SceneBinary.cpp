@@ -0,0 +1,305 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "Scene.h"
+#include "MappedFile.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+using namespace std;
+
+// Compiled scene files.
+// The text scene is parsed once and its content is written as a flat image :
+// a header followed by arrays of the exact structures the renderer uses.
+// Every array starts on a 16 bytes boundary. Loading maps the file and copies
+// every array into the containers of the scene in one go, without parsing
+// or converting anything, but it isn't used in place : the scene holds
+// std::vectors that the animation changes from frame to frame, and every blob
+// has a vector of its own for its centers, so one allocation per blob remains.
+// The format is tied to the layout of the structures of this executable,
+// the header records their sizes so that a mismatching file is rejected.
+
+#define BINARY_SCENE_VERSION 5
+
+static const char binarySceneMagic[8] = {'R','T','4','S','C','E','N','E'};
+
+struct binaryChunk {
+    unsigned int offset;
+    unsigned int count;
+};
+
+struct binaryBlob {
+    float size;
+    float invSizeSquare;
+    int materialId;
+    unsigned int firstCenter;
+    unsigned int centerCount;
+};
+
+struct binarySceneHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int headerSize;
+    unsigned int materialSize, sphereSize, blobSize, lightSize;
+
+    int sizex, sizey;
+    int complexity;
+    int maxDepth;
+    int perspectiveType;
+    float FOV, clearPoint, dispersion, invProjectionDistance;
+    int exposureType, bDither;
+    float fOutliers, fSmoothing, fMidPoint, fPower, fBlack, fPowerScale;
+    int bCubemapExposed, bCubemapsRGB;
+    float cubemapExposure;
+    // Offsets of the cubemap face names in the string chunk
+    unsigned int cubemapName[6];
+
+    binaryChunk materials;
+    binaryChunk spheres;
+    binaryChunk blobs;
+    binaryChunk blobCenters;
+    binaryChunk lights;
+    binaryChunk strings;
+};
+
+static size_t alignChunk(size_t offset)
+{
+    return (offset + 15) & ~size_t(15);
+}
+
+// Returns false if the chunk goes beyond the end of the file
+static bool checkChunk(const binaryChunk &chunk, size_t elementSize, size_t fileSize)
+{
+    return (chunk.offset % 16) == 0 && 
+           chunk.offset <= fileSize &&
+           chunk.count <= (fileSize - chunk.offset) / elementSize;
+}
+
+bool isBinaryScene(const char* inputName)
+{
+    char magic[sizeof(binarySceneMagic)];
+    ifstream sceneFile(inputName, ios_base::binary);
+    return sceneFile.read(magic, sizeof(magic)) && 
+           memcmp(magic, binarySceneMagic, sizeof(magic)) == 0;
+}
+
+bool loadBinaryScene(const char* inputName, scene &myScene)
+{
+    mappedFile sceneFile;
+    if (!sceneFile.Open(inputName))
+    {
+        cout << "Mal formed Scene file : cannot open the compiled scene." << endl;
+        return false;
+    }
+    if (sceneFile.size < sizeof(binarySceneHeader))
+    {
+        cout << "Mal formed Scene file : truncated compiled scene." << endl;
+        return false;
+    }
+    const binarySceneHeader &header = *reinterpret_cast<const binarySceneHeader *>(sceneFile.data);
+    if (memcmp(header.magic, binarySceneMagic, sizeof(header.magic)) != 0 ||
+        header.version != BINARY_SCENE_VERSION ||
+        header.headerSize != sizeof(binarySceneHeader) ||
+        header.materialSize != sizeof(material) ||
+        header.sphereSize != sizeof(sphere) ||
+        header.blobSize != sizeof(binaryBlob) ||
+        header.lightSize != sizeof(light))
+    {
+        cout << "Mal formed Scene file : Wrong compiled scene version, compile it again." << endl;
+        return false;
+    }
+    if (!checkChunk(header.materials, sizeof(material), sceneFile.size) ||
+        !checkChunk(header.spheres, sizeof(sphere), sceneFile.size) ||
+        !checkChunk(header.blobs, sizeof(binaryBlob), sceneFile.size) ||
+        !checkChunk(header.blobCenters, sizeof(point), sceneFile.size) ||
+        !checkChunk(header.lights, sizeof(light), sceneFile.size) ||
+        !checkChunk(header.strings, 1, sceneFile.size) ||
+        header.strings.count == 0 ||
+        sceneFile.data[header.strings.offset + header.strings.count - 1] != '\0')
+    {
+        cout << "Mal formed Scene file : truncated compiled scene." << endl;
+        return false;
+    }
+
+    myScene.sizex = header.sizex;
+    myScene.sizey = header.sizey;
+    myScene.complexity = header.complexity;
+    myScene.maxDepth = header.maxDepth;
+    myScene.persp.type = header.perspectiveType == perspective::conic ? perspective::conic : perspective::orthogonal;
+    myScene.persp.FOV = header.FOV;
+    myScene.persp.clearPoint = header.clearPoint;
+    myScene.persp.dispersion = header.dispersion;
+    myScene.persp.invProjectionDistance = header.invProjectionDistance;
+    myScene.tonemap.exposureType = header.exposureType == tonemapSettings::logAverage ? tonemapSettings::logAverage : tonemapSettings::rms;
+    myScene.tonemap.fOutliers = header.fOutliers;
+    myScene.tonemap.bDither = header.bDither != 0;
+    myScene.tonemap.fSmoothing = header.fSmoothing;
+    myScene.tonemap.fMidPoint = header.fMidPoint;
+    myScene.tonemap.fPower = header.fPower;
+    myScene.tonemap.fBlack = header.fBlack;
+    myScene.tonemap.fPowerScale = header.fPowerScale;
+    myScene.cm.bExposed = header.bCubemapExposed != 0;
+    myScene.cm.bsRGB = header.bCubemapsRGB != 0;
+    myScene.cm.exposure = header.cubemapExposure;
+    for (int i = cubemap::up; i <= cubemap::backward; ++i)
+    {
+        if (header.cubemapName[i] >= header.strings.count)
+        {
+            cout << "Mal formed Scene file : truncated compiled scene." << endl;
+            return false;
+        }
+        myScene.cm.name[i] = sceneFile.data + header.strings.offset + header.cubemapName[i];
+    }
+
+    // The arrays are the structures we render with, they are copied as they are
+    const material *materials = reinterpret_cast<const material *>(sceneFile.data + header.materials.offset);
+    const sphere *spheres = reinterpret_cast<const sphere *>(sceneFile.data + header.spheres.offset);
+    const light *lights = reinterpret_cast<const light *>(sceneFile.data + header.lights.offset);
+    const binaryBlob *blobs = reinterpret_cast<const binaryBlob *>(sceneFile.data + header.blobs.offset);
+    const point *centers = reinterpret_cast<const point *>(sceneFile.data + header.blobCenters.offset);
+
+    myScene.materialContainer.assign(materials, materials + header.materials.count);
+    myScene.sphereContainer.assign(spheres, spheres + header.spheres.count);
+    myScene.lightContainer.assign(lights, lights + header.lights.count);
+    myScene.blobContainer.resize(header.blobs.count);
+    for (unsigned int i = 0; i < header.blobs.count; ++i)
+    {
+        const binaryBlob &currentBlob = blobs[i];
+        if (currentBlob.firstCenter > header.blobCenters.count ||
+            currentBlob.centerCount > header.blobCenters.count - currentBlob.firstCenter ||
+            currentBlob.materialId < 0 || unsigned(currentBlob.materialId) >= header.materials.count)
+        {
+            cout << "Mal formed Scene file : Blob data is not valid." << endl;
+            return false;
+        }
+        blob &newBlob = myScene.blobContainer[i];
+        newBlob.centerList.assign(centers + currentBlob.firstCenter, 
+                                  centers + currentBlob.firstCenter + currentBlob.centerCount);
+        newBlob.size = currentBlob.size;
+        newBlob.invSizeSquare = currentBlob.invSizeSquare;
+        newBlob.materialId = currentBlob.materialId;
+    }
+    for (unsigned int i = 0; i < header.spheres.count; ++i)
+    {
+        if (spheres[i].materialId < 0 || unsigned(spheres[i].materialId) >= header.materials.count)
+        {
+            cout << "Mal formed Scene file : Material Id not valid." << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool compileScene(char* inputName, char* outputName)
+{
+    scene myScene;
+    if (isBinaryScene(inputName) || !parseScene(inputName, myScene))
+    {
+        cout << "Failure when reading the Scene file." << endl;
+        return false;
+    }
+    if (!myScene.animation.empty())
+    {
+        // The compiled format only holds a still scene
+        cout << "Animated scenes can't be compiled." << endl;
+        return false;
+    }
+
+    binarySceneHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, binarySceneMagic, sizeof(header.magic));
+    header.version = BINARY_SCENE_VERSION;
+    header.headerSize = sizeof(binarySceneHeader);
+    header.materialSize = sizeof(material);
+    header.sphereSize = sizeof(sphere);
+    header.blobSize = sizeof(binaryBlob);
+    header.lightSize = sizeof(light);
+
+    header.sizex = myScene.sizex;
+    header.sizey = myScene.sizey;
+    header.complexity = myScene.complexity;
+    header.maxDepth = myScene.maxDepth;
+    header.perspectiveType = myScene.persp.type;
+    header.FOV = myScene.persp.FOV;
+    header.clearPoint = myScene.persp.clearPoint;
+    header.dispersion = myScene.persp.dispersion;
+    header.invProjectionDistance = myScene.persp.invProjectionDistance;
+    header.exposureType = myScene.tonemap.exposureType;
+    header.fOutliers = myScene.tonemap.fOutliers;
+    header.bDither = myScene.tonemap.bDither;
+    header.fSmoothing = myScene.tonemap.fSmoothing;
+    header.fMidPoint = myScene.tonemap.fMidPoint;
+    header.fPower = myScene.tonemap.fPower;
+    header.fBlack = myScene.tonemap.fBlack;
+    header.fPowerScale = myScene.tonemap.fPowerScale;
+    header.bCubemapExposed = myScene.cm.bExposed;
+    header.bCubemapsRGB = myScene.cm.bsRGB;
+    header.cubemapExposure = myScene.cm.exposure;
+
+    // Flatten the blobs, their centers all go in the same array
+    vector<binaryBlob> blobs(myScene.blobContainer.size());
+    vector<point> centers;
+    for (size_t i = 0; i < myScene.blobContainer.size(); ++i)
+    {
+        const blob &currentBlob = myScene.blobContainer[i];
+        blobs[i].size = currentBlob.size;
+        blobs[i].invSizeSquare = currentBlob.invSizeSquare;
+        blobs[i].materialId = currentBlob.materialId;
+        blobs[i].firstCenter = unsigned(centers.size());
+        blobs[i].centerCount = unsigned(currentBlob.centerList.size());
+        centers.insert(centers.end(), currentBlob.centerList.begin(), currentBlob.centerList.end());
+    }
+
+    SimpleString strings;
+    for (int i = cubemap::up; i <= cubemap::backward; ++i)
+    {
+        header.cubemapName[i] = unsigned(strings.size());
+        strings.append(myScene.cm.name[i]);
+        strings.append('\0');
+    }
+
+    size_t offset = alignChunk(sizeof(header));
+    binaryChunk *chunks[] = {&header.materials, &header.spheres, &header.blobs, 
+                             &header.blobCenters, &header.lights, &header.strings};
+    const void *chunkData[] = {myScene.materialContainer.data(), myScene.sphereContainer.data(), blobs.data(),
+                               centers.data(), myScene.lightContainer.data(), strings.c_str()};
+    const size_t chunkCount[] = {myScene.materialContainer.size(), myScene.sphereContainer.size(), blobs.size(),
+                                 centers.size(), myScene.lightContainer.size(), size_t(strings.size())};
+    const size_t chunkElementSize[] = {sizeof(material), sizeof(sphere), sizeof(binaryBlob),
+                                       sizeof(point), sizeof(light), 1};
+    const int nbChunks = sizeof(chunks) / sizeof(chunks[0]);
+    for (int i = 0; i < nbChunks; ++i)
+    {
+        chunks[i]->offset = unsigned(offset);
+        chunks[i]->count = unsigned(chunkCount[i]);
+        offset = alignChunk(offset + chunkCount[i] * chunkElementSize[i]);
+        if (offset > 0xFFFFFFFFU)
+        {
+            cout << "The scene is too big to be compiled." << endl;
+            return false;
+        }
+    }
+
+    ofstream outputFile(outputName, ios_base::binary);
+    if (!outputFile)
+    {
+        cout << "Failure when creating the compiled scene file." << endl;
+        return false;
+    }
+    static const char padding[16] = {0};
+    outputFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    size_t written = sizeof(header);
+    for (int i = 0; i < nbChunks; ++i)
+    {
+        outputFile.write(padding, streamsize(chunks[i]->offset - written));
+        outputFile.write(static_cast<const char *>(chunkData[i]), streamsize(chunkCount[i] * chunkElementSize[i]));
+        written = chunks[i]->offset + chunkCount[i] * chunkElementSize[i];
+    }
+    outputFile.write(padding, streamsize(alignChunk(written) - written));
+    return bool(outputFile);
+}
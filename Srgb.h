@@ -1,24 +1,26 @@
-/*
-    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
-    It is free to use for educational purpose and cannot be redistributed
-    outside of the tutorial pages.
-    Any further inquiry :
-    mailto:info@codermind.com
- */
-
-#ifndef __SRGB_H
-#define __SRGB_H
-
-float srgbEncode(float c)
-{
-    if (c <= 0.0031308f)
-    {
-        return 12.92f * c; 
-    }
-    else
-    {
-        return 1.055f * powf(c, 0.4166667f) - 0.055f; // Inverse gamma 2.4
-    }
-}
-
-#endif //__SRGB_H
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __SRGB_H
+#define __SRGB_H
+
+#include <cmath>
+
+inline float srgbEncode(float c)
+{
+    if (c <= 0.0031308f)
+    {
+        return 12.92f * c; 
+    }
+    else
+    {
+        return 1.055f * powf(c, 0.4166667f) - 0.055f; // Inverse gamma 2.4
+    }
+}
+
+#endif //__SRGB_H
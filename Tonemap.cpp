@@ -0,0 +1,435 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
+using namespace std;
+
+#include "Tonemap.h"
+#include "Config.h"
+#include "Srgb.h"
+#include "Trace.h"
+
+static const SimpleString emptyString("");
+
+bool readTonemapSettings(const Config &sceneFile, tonemapSettings &tonemap)
+{
+    SimpleString exposureType = sceneFile.GetByNameAsString("Tonemap.Exposure", emptyString);
+    if (exposureType.compare("logaverage") == 0)
+    {
+        tonemap.exposureType = tonemapSettings::logAverage;
+    }
+    else if (exposureType.compare("rms") == 0 || exposureType.compare("") == 0)
+    {
+        // default
+        tonemap.exposureType = tonemapSettings::rms;
+    }
+    else
+    {
+        cout << "Mal formed Scene file : Tonemap exposure must be rms or logaverage." << endl;
+        return false;
+    }
+    tonemap.fOutliers = float(sceneFile.GetByNameAsFloat("Tonemap.Outliers", 0.0f));
+    tonemap.fMidPoint = float(sceneFile.GetByNameAsFloat("Tonemap.Midpoint", 0.6f));
+    tonemap.fPower    = float(sceneFile.GetByNameAsFloat("Tonemap.Power", 3.0f));
+    tonemap.fBlack    = float(sceneFile.GetByNameAsFloat("Tonemap.Black", 0.1f));
+    tonemap.bDither   = sceneFile.GetByNameAsBoolean("Tonemap.Dither", false);
+    tonemap.fSmoothing = float(sceneFile.GetByNameAsFloat("Tonemap.Smoothing", 0.75f));
+    return setupTonemap(tonemap);
+}
+
+bool setupTonemap(tonemapSettings &tonemap)
+{
+    if (tonemap.fOutliers < 0.0f || tonemap.fOutliers >= 0.5f)
+    {
+        cout << "Mal formed Scene file : Tonemap outliers must be between 0 and 0.5." << endl;
+        return false;
+    }
+    if (tonemap.fSmoothing < 0.0f || tonemap.fSmoothing >= 1.0f)
+    {
+        cout << "Mal formed Scene file : Tonemap smoothing must be between 0 and 1." << endl;
+        return false;
+    }
+    if (tonemap.fMidPoint <= 0.0f || tonemap.fMidPoint >= 1.0f)
+    {
+        cout << "Mal formed Scene file : Mid point must be between 0 and 1." << endl;
+		return false;
+    }
+    if (tonemap.fPower < 2.0f)
+    {
+        cout << "Mal formed Scene file : Tonemap power must be bigger than two." << endl;
+		return false;
+    }
+    if (tonemap.fBlack < 0.0f)
+    {
+        cout << "Mal formed Scene file : Tonemap black level cannot be negative." << endl;
+		return false;
+    }
+
+    if (tonemap.fBlack != 0.0f)
+    {
+        // if we have three user defined parameters
+        // there is one parameter left. It's the final scale of the exponent 
+        // we define it to be such that the midlevel gray stays the same, no matter what the power
+        // or the black level is (arbitrary). midpoint = 1 - exp(normExp) = 1 - exp(scale * normExp^power / (black + normExp^(power - 1)));
+        float normExp = - logf(1.0f - tonemap.fMidPoint);
+        tonemap.fPowerScale = - (1.0f + tonemap.fBlack / powf(normExp, tonemap.fPower - 1.0f));
+    }
+    else
+    {
+        tonemap.fPowerScale = -1.0f;
+    }
+    return true;
+}
+
+// Filmic curve applied to an exposed value
+static float exactCurve(const tonemapSettings &tonemap, float x)
+{
+    if (tonemap.fBlack > 0.0f)
+    {
+        return 1.0f - expf(tonemap.fPowerScale * powf(x, tonemap.fPower)   
+                           / (tonemap.fBlack + powf(x, tonemap.fPower - 1.0f)) );
+    }
+    // If the black level is 0 then all other parameters have no effect
+    return 1.0f - expf(tonemap.fPowerScale * x);
+}
+
+// The curve goes from 0 to 1 when the exposed value goes from 0 to infinity.
+// It is tabulated on u = x / (1 + x) which covers that range in [0, 1],
+// values between the entries are interpolated.
+// tonemapTableError measures the difference with the exact curve, it stays
+// below 2e-5 for the usual settings : a hundredth of an 8 bits step.
+const int curveTableSize = 4096;
+// Bigger exposed values, infinities and NaNs give the end of the curve,
+// negative ones (lights of negative intensity) its start
+const float maxExposed = 1e30f;
+
+struct curveTable
+{
+    float values[curveTableSize + 1];
+
+    explicit curveTable(const tonemapSettings &tonemap)
+    {
+        for (int i = 0; i < curveTableSize; ++i)
+        {
+            float u = float(i) / curveTableSize;
+            values[i] = exactCurve(tonemap, u / (1.0f - u));
+        }
+        values[curveTableSize] = 1.0f;
+    }
+    float lookup(float x) const
+    {
+        if (!(x < maxExposed))
+            x = maxExposed;
+        x = max(x, 0.0f);
+        float position = x / (1.0f + x) * curveTableSize;
+        int i = min(int(position), curveTableSize - 1);
+        float t = position - float(i);
+        return values[i] + t * (values[i + 1] - values[i]);
+    }
+};
+
+float tonemapTableError(const tonemapSettings &tonemap)
+{
+    curveTable table(tonemap);
+    float maxError = 0.0f;
+    const int steps = 16;
+    for (int i = 0; i < curveTableSize * steps; ++i)
+    {
+        float u = float(i) / (curveTableSize * steps);
+        float x = u / (1.0f - u);
+        maxError = max(maxError, fabsf(table.lookup(x) - exactCurve(tonemap, x)));
+    }
+    return maxError;
+}
+
+// 8 bits sRGB encoding of the linear values in [0, 1].
+// Without dithering the bytes are the same as (unsigned char)(255 * srgbEncode(c)) :
+// a table gives the byte at the start of every small interval, the steepest part
+// of the curve moves by a fifth of a step over an interval so at most one step
+// can be crossed and it is found with the exact thresholds of every byte.
+const int srgbTableSize = 16384;
+
+struct srgbTables
+{
+    unsigned char bytes[srgbTableSize + 1];
+    // Smallest linear value that encodes to each byte, one more as a sentinel
+    float thresholds[257];
+    // 255 * srgbEncode at every entry, for dithering
+    float values[srgbTableSize + 1];
+
+    srgbTables()
+    {
+        thresholds[0] = 0.0f;
+        for (int b = 1; b < 256; ++b)
+        {
+            // The encoding grows with the value, search on the bits of the floats
+            unsigned int low = 0, high = 0x3F800000;
+            while (low < high)
+            {
+                unsigned int middle = low + (high - low) / 2;
+                float c;
+                memcpy(&c, &middle, sizeof(c));
+                if (encode(c) >= b)
+                    high = middle;
+                else
+                    low = middle + 1;
+            }
+            memcpy(&thresholds[b], &low, sizeof(float));
+        }
+        thresholds[256] = numeric_limits<float>::max();
+        for (int i = 0; i <= srgbTableSize; ++i)
+        {
+            float c = float(i) / srgbTableSize;
+            bytes[i] = (unsigned char)encode(c);
+            values[i] = min(srgbEncode(c) * 255.0f, 255.0f);
+        }
+    }
+    static int encode(float c)
+    {
+        return int(min(srgbEncode(c) * 255.0f, 255.0f));
+    }
+    static const srgbTables &get()
+    {
+        static srgbTables tables;
+        return tables;
+    }
+    unsigned char quantize(float c) const
+    {
+        c = min(max(c, 0.0f), 1.0f);
+        int b = bytes[int(c * srgbTableSize)];
+        return (unsigned char)(b + (c >= thresholds[b + 1]));
+    }
+    float encoded(float c) const
+    {
+        float position = min(max(c, 0.0f), 1.0f) * srgbTableSize;
+        int i = min(int(position), srgbTableSize - 1);
+        float t = position - float(i);
+        return values[i] + t * (values[i + 1] - values[i]);
+    }
+};
+
+// Everything the threads share during a pass over the image
+struct tonemapJob
+{
+    const hdrImage *image;
+    const tonemapSettings *tonemap;
+    // Every row adds up the luminance of its fragments, the rows are then
+    // added in order so that the exposure doesn't depend on the threads
+    double *rowLuminance;
+    int *rowFragments;
+    // Brighter fragments are outliers left out of the exposure
+    float maxLuminance;
+    float exposure;
+    const curveTable *curve;
+    unsigned char *pixels;
+    // Rows are handed to the threads one at a time
+    atomic<int> nextRow;
+};
+
+static float luminance(const color &c)
+{
+    return 0.2126f * c.red + 0.715160f * c.green + 0.072169f * c.blue;
+}
+
+// Adds up the luminance of the fragments of a row, for the exposure
+static void exposureRow(tonemapJob &job, int y)
+{
+    double sum = 0.0;
+    int count = 0;
+    if (y >= calibrationRows)
+    {
+        bool bLogAverage = job.tonemap->exposureType == tonemapSettings::logAverage;
+        const color *fragment = job.image->fragments + 4 * size_t(y) * job.image->width;
+        for (int i = 0; i < 4 * job.image->width; ++i)
+        {
+            float fragmentLuminance = luminance(fragment[i]);
+            if (fragmentLuminance > job.maxLuminance)
+                continue;
+            // The small offset keeps the black fragments out of log(0)
+            sum += bLogAverage ? logf(1e-4f + fragmentLuminance) : fragmentLuminance * fragmentLuminance;
+            ++count;
+        }
+    }
+    job.rowLuminance[y] = sum;
+    job.rowFragments[y] = count;
+}
+
+static void exposureRows(tonemapJob *job)
+{
+    traceScope scope("exposureRows");
+    for (int y = job->nextRow++; y < job->image->height; y = job->nextRow++)
+    {
+        exposureRow(*job, y);
+    }
+}
+
+// Exposes and tonemaps the fragments of a row, then writes its pixels
+static void tonemapRow(tonemapJob &job, int y)
+{
+    int width = job.image->width;
+    unsigned char *pixel = job.pixels + 3 * size_t(y) * width;
+    if (y < calibrationRows)
+    {
+        for (int x = 0 ; x < width; ++x, pixel += 3)
+        {
+            // Use ten lines in the final image as an intensity calibration hint
+            if ((x / 10) & 1)
+            {
+                pixel[0] = pixel[1] = pixel[2] = 186;
+            }
+            else if ( y & 1)
+            {
+                pixel[0] = pixel[1] = pixel[2] = 255;
+            }
+            else
+            {
+                pixel[0] = pixel[1] = pixel[2] = 0;
+            }
+        }
+        return;
+    }
+
+    // The whole row goes through the curve, in the order of the pixel bytes
+    static thread_local vector<float> row;
+    row.resize(3 * size_t(width));
+    const color *fragment = job.image->fragments + 4 * size_t(y) * width;
+    const curveTable &curve = *job.curve;
+    float exposure = job.exposure;
+    for (int x = 0; x < width; ++x, fragment += 4)
+    {
+        float blue = 0.0f, green = 0.0f, red = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            blue  += curve.lookup(exposure * fragment[i].blue);
+            green += curve.lookup(exposure * fragment[i].green);
+            red   += curve.lookup(exposure * fragment[i].red);
+        }
+        row[3 * x]     = 0.25f * blue;
+        row[3 * x + 1] = 0.25f * green;
+        row[3 * x + 2] = 0.25f * red;
+    }
+
+    // Then gamma correction and quantization
+    const srgbTables &srgb = srgbTables::get();
+    if (!job.tonemap->bDither)
+    {
+        for (size_t i = 0; i < row.size(); ++i)
+            pixel[i] = srgb.quantize(row[i]);
+        return;
+    }
+    // The rounding error of each channel is carried to the next pixel of the row,
+    // the rows don't depend on each other so that they can still go in parallel
+    float error[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < row.size(); ++i)
+    {
+        float value = srgb.encoded(row[i]) + error[i % 3];
+        float rounded = min(max(floorf(value + 0.5f), 0.0f), 255.0f);
+        error[i % 3] = value - rounded;
+        pixel[i] = (unsigned char)rounded;
+    }
+}
+
+static void tonemapRows(tonemapJob *job)
+{
+    traceScope scope("tonemapRows");
+    for (int y = job->nextRow++; y < job->image->height; y = job->nextRow++)
+    {
+        tonemapRow(*job, y);
+    }
+}
+
+static void tonemapThread(void (*rows)(tonemapJob *), tonemapJob *job)
+{
+    traceThreadName("tonemap");
+    rows(job);
+}
+
+// Shares the rows of the image between the threads,
+// the calling thread takes its share too
+static void runPass(tonemapJob &job, int nbThreads, void (*rows)(tonemapJob *))
+{
+    job.nextRow = 0;
+    if (nbThreads <= 0)
+        nbThreads = max(1, int(thread::hardware_concurrency()));
+    nbThreads = min(nbThreads, job.image->height);
+    vector<thread> threads;
+    for (int i = 1; i < nbThreads; ++i)
+    {
+        threads.push_back(thread(tonemapThread, rows, &job));
+    }
+    rows(&job);
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i].join();
+    }
+}
+
+float computeExposure(const hdrImage &image, const tonemapSettings &tonemap, int nbThreads)
+{
+    tonemapJob job;
+    job.image = &image;
+    job.tonemap = &tonemap;
+    job.maxLuminance = numeric_limits<float>::max();
+    if (tonemap.fOutliers > 0.0f && image.height > calibrationRows)
+    {
+        traceScope scope("outliers");
+        const color *fragment = image.fragments + 4 * size_t(calibrationRows) * image.width;
+        vector<float> luminances(4 * size_t(image.height - calibrationRows) * image.width);
+        for (size_t i = 0; i < luminances.size(); ++i)
+        {
+            luminances[i] = luminance(fragment[i]);
+        }
+        size_t kept = size_t((1.0f - tonemap.fOutliers) * (luminances.size() - 1));
+        nth_element(luminances.begin(), luminances.begin() + kept, luminances.end());
+        job.maxLuminance = luminances[kept];
+    }
+
+    vector<double> rowLuminance(image.height);
+    vector<int> rowFragments(image.height);
+    job.rowLuminance = &rowLuminance[0];
+    job.rowFragments = &rowFragments[0];
+    runPass(job, nbThreads, exposureRows);
+
+    double sum = 0.0;
+    long long count = 0;
+    for (int y = 0; y < image.height; ++y)
+    {
+        sum += rowLuminance[y];
+        count += rowFragments[y];
+    }
+    if (count == 0)
+        return -1.0f;
+    float mediumLuminance;
+    if (tonemap.exposureType == tonemapSettings::logAverage)
+        mediumLuminance = float(exp(sum / count));
+    else
+        mediumLuminance = float(sqrt(sum / count));
+    if (mediumLuminance <= 0.0f)
+        return -1.0f;
+    return - logf(1.0f - tonemap.fMidPoint) / mediumLuminance;
+}
+
+void tonemapImage(const hdrImage &image, const tonemapSettings &tonemap, float exposure,
+                  unsigned char *pixels, int nbThreads)
+{
+    tonemapJob job;
+    job.image = &image;
+    job.tonemap = &tonemap;
+    job.exposure = exposure;
+    curveTable curve(tonemap);
+    job.curve = &curve;
+    job.pixels = pixels;
+    runPass(job, nbThreads, tonemapRows);
+}
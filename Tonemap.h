@@ -0,0 +1,63 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __TONEMAP_H
+#define __TONEMAP_H
+
+#include "Def.h"
+class Config;
+
+// The bottom rows of every image are an intensity calibration hint
+const int calibrationRows = 10;
+
+struct tonemapSettings {
+    // How the luminance of the rendered image is averaged for the exposure
+    enum exposure {
+        rms = 0,
+        logAverage = 1
+    }     exposureType;
+    // Fraction of the brightest fragments left out of the exposure
+    float fOutliers;
+    float fMidPoint;
+    float fPower;
+    float fBlack;
+    float fPowerScale;
+    // Error diffusion instead of truncation to 8 bits
+    bool  bDither;
+    // Weight of the previous frames in the exposure of an animation
+    float fSmoothing;
+};
+
+// Reads the Tonemap keys of the current section of a scene file.
+// Returns false, after saying why, when a value is out of range.
+bool readTonemapSettings(const Config &sceneFile, tonemapSettings &tonemap);
+
+// Checks the values and computes the scale of the curve from them,
+// for settings that didn't come from a scene file.
+bool setupTonemap(tonemapSettings &tonemap);
+
+// Linear image before tonemapping. Every pixel is made of two by two
+// fragments stored next to each other : (x, y), (x, y + 0.5), (x + 0.5, y)
+// then (x + 0.5, y + 0.5). The calibration rows are left black.
+struct hdrImage {
+    int width, height;
+    color *fragments;
+};
+
+// Exposure that maps the average luminance of the image to the mid point
+float computeExposure(const hdrImage &image, const tonemapSettings &tonemap, int nbThreads);
+
+// Largest difference between the tabulated curve used by tonemapImage
+// and the exact one
+float tonemapTableError(const tonemapSettings &tonemap);
+
+// Writes the 24 bits BGR pixels of the image, calibration rows included
+void tonemapImage(const hdrImage &image, const tonemapSettings &tonemap, float exposure,
+                  unsigned char *pixels, int nbThreads);
+
+#endif //__TONEMAP_H
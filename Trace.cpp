@@ -0,0 +1,279 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include "Trace.h"
+#include "AllocTracker.h"
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+bool g_bTraceEnabled = false;
+
+struct traceEvent
+{
+    const char *name;
+    int arg;
+    long long start, duration;
+    perfCounters counters;
+    // Heap allocations of the span, -1 unless they are tracked
+    long long allocations;
+};
+
+// Spans are only ever appended by their own thread, the lock is only taken
+// when a thread records its first span.
+struct traceBuffer
+{
+    int threadId;
+    const char *threadName;
+    vector<traceEvent> events;
+};
+
+static mutex traceLock;
+static vector<traceBuffer *> traceBuffers;
+static chrono::steady_clock::time_point traceOrigin;
+static thread_local traceBuffer *currentBuffer = NULL;
+
+static traceBuffer *getBuffer()
+{
+    if (!currentBuffer)
+    {
+        traceBuffer *buffer = new traceBuffer;
+        buffer->threadName = NULL;
+        buffer->events.reserve(1024);
+        lock_guard<mutex> guard(traceLock);
+        buffer->threadId = int(traceBuffers.size());
+        traceBuffers.push_back(buffer);
+        currentBuffer = buffer;
+    }
+    return currentBuffer;
+}
+
+// Nanoseconds since tracing was enabled
+static long long traceNow()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceOrigin).count();
+}
+
+void traceEnable()
+{
+    traceOrigin = chrono::steady_clock::now();
+    g_bTraceEnabled = true;
+}
+
+void traceScope::begin(const char *scopeName, int scopeArg)
+{
+    name = scopeName;
+    arg = scopeArg;
+    if (g_bPerfEnabled)
+        perfRead(startCounters);
+    startAllocations = threadAllocations();
+    start = traceNow();
+}
+
+void traceScope::end()
+{
+    traceEvent event = {name, arg, start, traceNow() - start};
+    long long allocations = threadAllocations();
+    event.allocations = allocations < 0 ? -1 : allocations - startAllocations;
+    if (g_bPerfEnabled)
+    {
+        perfRead(event.counters);
+        for (int i = 0; i < perfCounters::counterCount; ++i)
+        {
+            if (event.counters.values[i] < 0 || startCounters.values[i] < 0)
+                event.counters.values[i] = -1;
+            else
+                event.counters.values[i] -= startCounters.values[i];
+        }
+    }
+    getBuffer()->events.push_back(event);
+}
+
+void traceThreadName(const char *name)
+{
+    if (g_bTraceEnabled)
+        getBuffer()->threadName = name;
+}
+
+bool traceWrite(const char *fileName)
+{
+    FILE *traceFile = fopen(fileName, "w");
+    if (!traceFile)
+        return false;
+    // Timestamps are in microseconds in this format
+    fprintf(traceFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    const char *separator = "";
+    for (size_t i = 0; i < traceBuffers.size(); ++i)
+    {
+        const traceBuffer &buffer = *traceBuffers[i];
+        if (buffer.threadName)
+            fprintf(traceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    separator, buffer.threadId, buffer.threadName);
+        else
+            fprintf(traceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                    separator, buffer.threadId, buffer.threadId);
+        separator = ",\n";
+        for (size_t j = 0; j < buffer.events.size(); ++j)
+        {
+            const traceEvent &event = buffer.events[j];
+            fprintf(traceFile, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    event.name, buffer.threadId, event.start * 1e-3, event.duration * 1e-3);
+            const char *argSeparator = ",\"args\":{";
+            if (event.arg >= 0)
+            {
+                fprintf(traceFile, "%s\"index\":%d", argSeparator, event.arg);
+                argSeparator = ",";
+            }
+            for (int k = 0; g_bPerfEnabled && k < perfCounters::counterCount; ++k)
+            {
+                if (event.counters.values[k] < 0)
+                    continue;
+                fprintf(traceFile, "%s\"%s\":%lld", argSeparator, perfCounterName(k), event.counters.values[k]);
+                argSeparator = ",";
+            }
+            // The separator becomes a plain comma once an argument was written
+            fprintf(traceFile, strcmp(argSeparator, ",") == 0 ? "}}" : "}");
+        }
+    }
+    fprintf(traceFile, "\n]}\n");
+    return fclose(traceFile) == 0;
+}
+
+struct traceTotal
+{
+    const char *name;
+    int threadId;
+    int count;
+    long long total, maximum;
+    long long allocations;
+    // Counts of the spans, -1 when a counter was missing
+    long long counters[perfCounters::counterCount];
+};
+
+static void addToTotals(vector<traceTotal> &totals, const traceEvent &event, int threadId)
+{
+    size_t k = 0;
+    while (k < totals.size() && (strcmp(totals[k].name, event.name) != 0 || totals[k].threadId != threadId))
+        ++k;
+    if (k == totals.size())
+    {
+        traceTotal total = {event.name, threadId, 0, 0, 0, 0, {0}};
+        totals.push_back(total);
+    }
+    traceTotal &total = totals[k];
+    total.count++;
+    total.total += event.duration;
+    total.allocations += event.allocations;
+    if (event.duration > total.maximum)
+        total.maximum = event.duration;
+    for (int i = 0; i < perfCounters::counterCount; ++i)
+    {
+        if (event.counters.values[i] < 0 || total.counters[i] < 0)
+            total.counters[i] = -1;
+        else
+            total.counters[i] += event.counters.values[i];
+    }
+}
+
+// Misses per thousand instructions, the usual way to tell a memory bound phase
+static void printPerKilo(long long count, long long instructions)
+{
+    if (count < 0 || instructions <= 0)
+        printf(" %9s", "n/a");
+    else
+        printf(" %9.2f", 1000.0 * count / instructions);
+}
+
+static void printCounters(const traceTotal &total)
+{
+    const long long *c = total.counters;
+    if (c[perfCounters::cycles] < 0)
+        printf(" %9s", "n/a");
+    else
+        printf(" %9.1f", c[perfCounters::cycles] * 1e-6);
+    if (c[perfCounters::cycles] <= 0 || c[perfCounters::instructions] < 0)
+        printf(" %6s", "n/a");
+    else
+        printf(" %6.2f", double(c[perfCounters::instructions]) / c[perfCounters::cycles]);
+    printPerKilo(c[perfCounters::l1dMisses], c[perfCounters::instructions]);
+    printPerKilo(c[perfCounters::llcMisses], c[perfCounters::instructions]);
+    printPerKilo(c[perfCounters::branchMisses], c[perfCounters::instructions]);
+    if (c[perfCounters::pageFaults] < 0)
+        printf(" %8s", "n/a");
+    else
+        printf(" %8lld", c[perfCounters::pageFaults]);
+}
+
+void traceSummary()
+{
+    // Totals per phase, and per phase and thread for the phases that ran on several threads
+    vector<traceTotal> totals, threadTotals;
+    long long first = 0, last = 0;
+    bool bEmpty = true;
+    for (size_t i = 0; i < traceBuffers.size(); ++i)
+    for (size_t j = 0; j < traceBuffers[i]->events.size(); ++j)
+    {
+        const traceEvent &event = traceBuffers[i]->events[j];
+        if (bEmpty || event.start < first)
+            first = event.start;
+        if (bEmpty || event.start + event.duration > last)
+            last = event.start + event.duration;
+        bEmpty = false;
+        addToTotals(totals, event, -1);
+        addToTotals(threadTotals, event, traceBuffers[i]->threadId);
+    }
+    if (bEmpty)
+        return;
+    // Spans of several threads add up, so a phase can take more than 100% of the run
+    double wall = double(last - first);
+    printf("%-16s %8s %12s %12s %12s %8s", "phase", "count", "total ms", "mean ms", "max ms", "% run");
+    // Allocations are only known in builds that track them
+    bool bAllocations = threadAllocations() >= 0;
+    if (bAllocations)
+        printf(" %10s", "allocs");
+    if (g_bPerfEnabled)
+        printf(" %9s %6s %9s %9s %9s %8s", "Mcycles", "IPC", "L1D/ki", "LLC/ki", "brmiss/ki", "faults");
+    printf("\n");
+    for (size_t k = 0; k < totals.size(); ++k)
+    {
+        printf("%-16s %8d %12.3f %12.3f %12.3f %7.1f%%", totals[k].name, totals[k].count,
+               totals[k].total * 1e-6, totals[k].total * 1e-6 / totals[k].count,
+               totals[k].maximum * 1e-6, wall > 0.0 ? 100.0 * totals[k].total / wall : 0.0);
+        if (bAllocations)
+            printf(" %10lld", totals[k].allocations);
+        if (g_bPerfEnabled)
+            printCounters(totals[k]);
+        printf("\n");
+        int nbThreads = 0;
+        for (size_t t = 0; t < threadTotals.size(); ++t)
+            if (strcmp(threadTotals[t].name, totals[k].name) == 0)
+                ++nbThreads;
+        for (size_t t = 0; nbThreads > 1 && t < threadTotals.size(); ++t)
+        {
+            const traceTotal &total = threadTotals[t];
+            if (strcmp(total.name, totals[k].name) != 0)
+                continue;
+            const traceBuffer &buffer = *traceBuffers[total.threadId];
+            char threadName[32];
+            snprintf(threadName, sizeof(threadName), "  %s %d", buffer.threadName ? buffer.threadName : "thread", total.threadId);
+            printf("%-16s %8d %12.3f %12.3f %12.3f %7.1f%%", threadName, total.count,
+                   total.total * 1e-6, total.total * 1e-6 / total.count,
+                   total.maximum * 1e-6, wall > 0.0 ? 100.0 * total.total / wall : 0.0);
+            if (bAllocations)
+                printf(" %10lld", total.allocations);
+            if (g_bPerfEnabled)
+                printCounters(total);
+            printf("\n");
+        }
+    }
+    printf("%-16s %8s %12.3f\n", "run", "", wall * 1e-6);
+}
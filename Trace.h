@@ -0,0 +1,63 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __TRACE_H
+#define __TRACE_H
+
+// Timing of the phases of a run (loading, exposure, rendering of each row..).
+// Tracing is off by default and a traceScope then costs a single test.
+// Once enabled, every scope records a span in a buffer owned by its thread,
+// and the whole timeline can be written in the Chrome trace format
+// (chrome://tracing or ui.perfetto.dev) or summarized per phase.
+// When the performance counters are enabled too, every span also records
+// the counts of its thread (cycles, instructions, cache misses..).
+
+#include "PerfCounters.h"
+
+extern bool g_bTraceEnabled;
+
+void traceEnable();
+
+// Records the span between its construction and its destruction.
+// The name must be a literal, only the pointer is kept.
+struct traceScope
+{
+    const char *name;
+    int arg;
+    long long start;
+    perfCounters startCounters;
+    long long startAllocations;
+
+    traceScope(const char *scopeName, int scopeArg = -1) : name(0)
+    {
+        if (g_bTraceEnabled)
+            begin(scopeName, scopeArg);
+    }
+    ~traceScope()
+    {
+        if (name)
+            end();
+    }
+private:
+    void begin(const char *scopeName, int scopeArg);
+    void end();
+    traceScope(const traceScope &);
+    traceScope & operator = (const traceScope &);
+};
+
+// Names the current thread in the trace
+void traceThreadName(const char *name);
+
+// Writes every span recorded so far, no thread may be tracing at that time
+bool traceWrite(const char *fileName);
+
+// Prints the count, total, mean and maximum duration of each kind of span,
+// with the performance counters per phase and per thread when enabled.
+void traceSummary();
+
+#endif //__TRACE_H
@@ -0,0 +1,476 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+using namespace std;
+
+#include "Wavefront.h"
+#include "Ray.h"
+#include "Raytrace.h"
+#include "Scene.h"
+
+void rayQueue::reserve(size_t capacity)
+{
+    startx.resize(capacity); starty.resize(capacity); startz.resize(capacity);
+    dirx.resize(capacity); diry.resize(capacity); dirz.resize(capacity);
+    coef.resize(capacity);
+    refractionCoef.resize(capacity);
+    slot.resize(capacity);
+    size = 0;
+}
+
+inline void rayQueue::push(float sx, float sy, float sz, float dx, float dy, float dz, float pathCoef, float pathRefraction, int pathSlot)
+{
+    startx[size] = sx; starty[size] = sy; startz[size] = sz;
+    dirx[size] = dx; diry[size] = dy; dirz[size] = dz;
+    coef[size] = pathCoef;
+    refractionCoef[size] = pathRefraction;
+    slot[size] = pathSlot;
+    ++size;
+}
+
+void shadowQueue::reserve(size_t capacity)
+{
+    startx.resize(capacity); starty.resize(capacity); startz.resize(capacity);
+    dirx.resize(capacity); diry.resize(capacity); dirz.resize(capacity);
+    maxT.resize(capacity);
+    normalx.resize(capacity); normaly.resize(capacity); normalz.resize(capacity);
+    viewx.resize(capacity); viewy.resize(capacity); viewz.resize(capacity);
+    lightProjection.resize(capacity);
+    viewProjection.resize(capacity);
+    coef.resize(capacity);
+    materialId.resize(capacity);
+    lightId.resize(capacity);
+    slot.resize(capacity);
+    occluded.resize(capacity);
+    size = 0;
+}
+
+void wavefrontTimes::add(const wavefrontTimes &other)
+{
+    extend += other.extend;
+    shade += other.shade;
+    shadow += other.shadow;
+    sort += other.sort;
+    miss += other.miss;
+}
+
+wavefront::wavefront() : bSortRays(false)
+{
+    wavefrontTimes zero = {0.0, 0.0, 0.0, 0.0, 0.0};
+    times = zero;
+}
+
+void wavefront::reserve(size_t primaryRays, size_t lightCount)
+{
+    // A path goes on in at most one ray, and stops at most once
+    paths.reserve(primaryRays);
+    next.reserve(primaryRays);
+    misses.reserve(primaryRays);
+    hitT.resize(primaryRays);
+    hitObject.resize(primaryRays);
+    shadows.reserve(primaryRays * max(size_t(1), lightCount));
+    if (bSortRays)
+    {
+        sorted.reserve(primaryRays);
+        sortKeys.resize(primaryRays);
+        sortScratch.resize(primaryRays);
+    }
+}
+
+void wavefront::addPrimary(const ray &viewRay, int slot)
+{
+    paths.push(viewRay.start.x, viewRay.start.y, viewRay.start.z, viewRay.dir.x, viewRay.dir.y, viewRay.dir.z,
+               1.0f, context::getDefaultAir().fRefractionCoef, slot);
+}
+
+static inline ray queuedRay(const rayQueue &queue, size_t i)
+{
+    ray r = { {queue.startx[i], queue.starty[i], queue.startz[i]}, {queue.dirx[i], queue.diry[i], queue.dirz[i]} };
+    return r;
+}
+
+// Nearest hit of every path, in the same order as addRay : the blobs, then
+// the spheres, that win when they are closer
+static void extendStage(const scene &myScene, const rayQueue &paths, float *hitT, int *hitObject)
+{
+    size_t n = paths.size;
+    int nbSpheres = int(myScene.sphereContainer.size());
+    for (size_t i = 0; i < n; ++i)
+    {
+        hitT[i] = 2000.0f;
+        hitObject[i] = -1;
+    }
+    for (unsigned int b = 0; b < myScene.blobContainer.size(); ++b)
+    {
+        const blob &currentBlob = myScene.blobContainer[b];
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (isBlobIntersected(queuedRay(paths, i), currentBlob, hitT[i]))
+                hitObject[i] = nbSpheres + int(b);
+        }
+    }
+    // Same arithmetic as hitSphere, without branches so that it runs
+    // over several rays at once
+    const float *startx = &paths.startx[0], *starty = &paths.starty[0], *startz = &paths.startz[0];
+    const float *dirx = &paths.dirx[0], *diry = &paths.diry[0], *dirz = &paths.dirz[0];
+    for (int s = 0; s < nbSpheres; ++s)
+    {
+        const sphere &currentSphere = myScene.sphereContainer[s];
+        float sizeSquare = currentSphere.size * currentSphere.size;
+        for (size_t i = 0; i < n; ++i)
+        {
+            float distx = currentSphere.pos.x - startx[i];
+            float disty = currentSphere.pos.y - starty[i];
+            float distz = currentSphere.pos.z - startz[i];
+            float B = dirx[i] * distx + diry[i] * disty + dirz[i] * distz;
+            float D = B * B - (distx * distx + disty * disty + distz * distz) + sizeSquare;
+            float root = sqrtf(max(D, 0.0f));
+            float t0 = B - root, t1 = B + root;
+            // A root counts past 0.1, when there is one
+            float nearest = D >= 0.0f ? 0.1f : numeric_limits<float>::max();
+            float t = hitT[i];
+            float hit0 = t0 > nearest ? t0 : t;
+            float newT = hit0 < t ? hit0 : t;
+            float hit1 = t1 > nearest ? t1 : newT;
+            newT = hit1 < newT ? hit1 : newT;
+            hitT[i] = newT;
+            hitObject[i] = newT != t ? s : hitObject[i];
+        }
+    }
+}
+
+// What addRay does at a hit point, for every path of the queue. The paths
+// that bounce go to next, the ones that stop on a diffuse surface queue their
+// shadow rays, and the ones that found nothing go to the misses.
+static void shadeStage(scene &myScene, const rayQueue &paths, const float *hitT, const int *hitObject,
+                       rayQueue &next, shadowQueue &shadows, rayQueue &misses)
+{
+    int nbSpheres = int(myScene.sphereContainer.size());
+    for (size_t i = 0; i < paths.size; ++i)
+    {
+        float coef = paths.coef[i];
+        int object = hitObject[i];
+        ray viewRay = queuedRay(paths, i);
+        if (object < 0)
+        {
+            misses.push(viewRay.start.x, viewRay.start.y, viewRay.start.z, viewRay.dir.x, viewRay.dir.y, viewRay.dir.z,
+                        coef, paths.refractionCoef[i], paths.slot[i]);
+            continue;
+        }
+        point ptHitPoint = viewRay.start + hitT[i] * viewRay.dir;
+        vecteur vNormal;
+        int currentMatId;
+        if (object >= nbSpheres)
+        {
+            const blob &currentBlob = myScene.blobContainer[object - nbSpheres];
+            blobInterpolation(ptHitPoint, currentBlob, vNormal);
+            currentMatId = currentBlob.materialId;
+        }
+        else
+        {
+            vNormal = ptHitPoint - myScene.sphereContainer[object].pos;
+            currentMatId = myScene.sphereContainer[object].materialId;
+        }
+        const material &currentMat = myScene.materialContainer[currentMatId];
+        float temp = vNormal * vNormal;
+        bool bNormal = temp != 0.0f;
+        if (bNormal)
+        {
+            vNormal = invsqrtf(temp) * vNormal;
+        }
+        bool bInside = vNormal * viewRay.dir > 0.0f;
+        if (bInside)
+            vNormal = -1.0f * vNormal;
+        if (!bNormal || (currentMat.bump && !bumpNormal(currentMat, ptHitPoint, vNormal)))
+        {
+            // addRay gives up on the path, it only gets the cubemap
+            misses.push(viewRay.start.x, viewRay.start.y, viewRay.start.z, viewRay.dir.x, viewRay.dir.y, viewRay.dir.z,
+                        coef, paths.refractionCoef[i], paths.slot[i]);
+            continue;
+        }
+
+        float fViewProjection = viewRay.dir * vNormal;
+        float fReflectance, fTransmittance, fCosThetaI, fCosThetaT;
+        fresnelTerms(currentMat, fViewProjection, bInside, paths.refractionCoef[i], fReflectance, fCosThetaI, fCosThetaT);
+        fTransmittance = currentMat.refraction * (1.0f - fReflectance);
+        fReflectance = currentMat.reflection * fReflectance;
+        float fTotalWeight = fReflectance + fTransmittance;
+        if (fTotalWeight > 0.0f)
+        {
+            float fRoulette = randomUnit();
+            if (fRoulette <= fReflectance)
+            {
+                coef *= currentMat.reflection;
+                vecteur dir = viewRay.dir + (- 2.0f * fViewProjection) * vNormal;
+                if (coef > 0.0f)
+                    next.push(ptHitPoint.x, ptHitPoint.y, ptHitPoint.z, dir.x, dir.y, dir.z, coef, paths.refractionCoef[i], paths.slot[i]);
+                continue;
+            }
+            if (fRoulette <= fTotalWeight)
+            {
+                coef *= currentMat.refraction;
+                float fOldRefractionCoef = paths.refractionCoef[i];
+                float fNewRefractionCoef = bInside ? context::getDefaultAir().fRefractionCoef : currentMat.density;
+                // Snell-Descartes, as in addRay
+                vecteur dir = viewRay.dir + fCosThetaI * vNormal;
+                dir = (fOldRefractionCoef / fNewRefractionCoef) * dir;
+                dir += (-fCosThetaT) * vNormal;
+                if (coef > 0.0f)
+                    next.push(ptHitPoint.x, ptHitPoint.y, ptHitPoint.z, dir.x, dir.y, dir.z, coef, fNewRefractionCoef, paths.slot[i]);
+                continue;
+            }
+        }
+        if (bInside)
+        {
+            // addRay doesn't light the inside of the objects, the same ray goes on
+            next.push(viewRay.start.x, viewRay.start.y, viewRay.start.z, viewRay.dir.x, viewRay.dir.y, viewRay.dir.z,
+                      coef, paths.refractionCoef[i], paths.slot[i]);
+            continue;
+        }
+        for (unsigned int j = 0; j < myScene.lightContainer.size(); ++j)
+        {
+            vecteur lightDir = myScene.lightContainer[j].pos - ptHitPoint;
+            float fLightProjection = lightDir * vNormal;
+            if (fLightProjection <= 0.0f)
+                continue;
+            float lightDist = lightDir * lightDir;
+            if (lightDist == 0.0f)
+                continue;
+            float invDist = invsqrtf(lightDist);
+            lightDir = invDist * lightDir;
+            size_t k = shadows.size++;
+            shadows.startx[k] = ptHitPoint.x; shadows.starty[k] = ptHitPoint.y; shadows.startz[k] = ptHitPoint.z;
+            shadows.dirx[k] = lightDir.x; shadows.diry[k] = lightDir.y; shadows.dirz[k] = lightDir.z;
+            // addRay searches up to the squared distance
+            shadows.maxT[k] = lightDist;
+            shadows.normalx[k] = vNormal.x; shadows.normaly[k] = vNormal.y; shadows.normalz[k] = vNormal.z;
+            shadows.viewx[k] = viewRay.dir.x; shadows.viewy[k] = viewRay.dir.y; shadows.viewz[k] = viewRay.dir.z;
+            shadows.lightProjection[k] = invDist * fLightProjection;
+            shadows.viewProjection[k] = fViewProjection;
+            shadows.coef[k] = coef;
+            shadows.materialId[k] = currentMatId;
+            shadows.lightId[k] = int(j);
+            shadows.slot[k] = paths.slot[i];
+        }
+    }
+}
+
+// Occlusion of every shadow ray, sphere by sphere then blob by blob
+// for the ones still visible, and the light of the visible ones
+static void shadowStage(scene &myScene, shadowQueue &shadows, color *results)
+{
+    size_t n = shadows.size;
+    unsigned char *occluded = &shadows.occluded[0];
+    const float *startx = &shadows.startx[0], *starty = &shadows.starty[0], *startz = &shadows.startz[0];
+    const float *dirx = &shadows.dirx[0], *diry = &shadows.diry[0], *dirz = &shadows.dirz[0];
+    const float *maxT = &shadows.maxT[0];
+    for (size_t i = 0; i < n; ++i)
+        occluded[i] = 0;
+    for (unsigned int s = 0; s < myScene.sphereContainer.size(); ++s)
+    {
+        const sphere &currentSphere = myScene.sphereContainer[s];
+        float sizeSquare = currentSphere.size * currentSphere.size;
+        for (size_t i = 0; i < n; ++i)
+        {
+            float distx = currentSphere.pos.x - startx[i];
+            float disty = currentSphere.pos.y - starty[i];
+            float distz = currentSphere.pos.z - startz[i];
+            float B = dirx[i] * distx + diry[i] * disty + dirz[i] * distz;
+            float D = B * B - (distx * distx + disty * disty + distz * distz) + sizeSquare;
+            float root = sqrtf(max(D, 0.0f));
+            float t0 = B - root, t1 = B + root;
+            bool bHit = (D >= 0.0f) & (((t0 > 0.1f) & (t0 < maxT[i])) | ((t1 > 0.1f) & (t1 < maxT[i])));
+            occluded[i] |= (unsigned char)bHit;
+        }
+    }
+    for (unsigned int b = 0; b < myScene.blobContainer.size(); ++b)
+    {
+        const blob &currentBlob = myScene.blobContainer[b];
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (occluded[i])
+                continue;
+            ray lightRay = { {startx[i], starty[i], startz[i]}, {dirx[i], diry[i], dirz[i]} };
+            float t = maxT[i];
+            if (isBlobIntersected(lightRay, currentBlob, t))
+                occluded[i] = 1;
+        }
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (occluded[i])
+            continue;
+        point ptHitPoint = {startx[i], starty[i], startz[i]};
+        vecteur vLightDir = {dirx[i], diry[i], dirz[i]};
+        vecteur vNormal = {shadows.normalx[i], shadows.normaly[i], shadows.normalz[i]};
+        vecteur vViewDir = {shadows.viewx[i], shadows.viewy[i], shadows.viewz[i]};
+        addDirectLight(myScene.materialContainer[shadows.materialId[i]], myScene.lightContainer[shadows.lightId[i]],
+                       ptHitPoint, vLightDir, vNormal, vViewDir, shadows.lightProjection[i], shadows.viewProjection[i],
+                       shadows.coef[i], results[shadows.slot[i]]);
+    }
+}
+
+// The cubemap seen by the paths that left the scene
+static void missStage(const scene &myScene, const rayQueue &misses, color *results)
+{
+    for (size_t i = 0; i < misses.size; ++i)
+    {
+        results[misses.slot[i]] += misses.coef[i] * readCubemap(myScene.cm, queuedRay(misses, i));
+    }
+}
+
+// Spreads the 10 low bits of v to every third bit, to interleave three coordinates
+static inline unsigned int spreadBits(unsigned int v)
+{
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+static inline unsigned int mortonKey(float x, float y, float z)
+{
+    // Coordinates in [0, 1], on 10 bits each
+    unsigned int cellx = (unsigned int)(min(max(x, 0.0f), 1.0f) * 1023.0f);
+    unsigned int celly = (unsigned int)(min(max(y, 0.0f), 1.0f) * 1023.0f);
+    unsigned int cellz = (unsigned int)(min(max(z, 0.0f), 1.0f) * 1023.0f);
+    return (spreadBits(cellx) << 2) | (spreadBits(celly) << 1) | spreadBits(cellz);
+}
+
+// Reorders the queue by the keys of 30 bits in the high half of keys, the low
+// half holds the indices of the rays. Radix sort of 10 bits per pass.
+static void sortQueue(rayQueue &queue, rayQueue &sorted, unsigned long long *keys, unsigned long long *scratch)
+{
+    const int digitBits = 10, digitCount = 1 << digitBits;
+    unsigned int counts[digitCount];
+    unsigned long long *from = keys, *to = scratch;
+    for (int shift = 32; shift < 32 + 3 * digitBits; shift += digitBits)
+    {
+        fill(counts, counts + digitCount, 0U);
+        for (size_t i = 0; i < queue.size; ++i)
+            ++counts[(from[i] >> shift) & (digitCount - 1)];
+        unsigned int offset = 0;
+        for (int d = 0; d < digitCount; ++d)
+        {
+            unsigned int count = counts[d];
+            counts[d] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < queue.size; ++i)
+            to[counts[(from[i] >> shift) & (digitCount - 1)]++] = from[i];
+        swap(from, to);
+    }
+    keys = from;
+    sorted.size = 0;
+    for (size_t i = 0; i < queue.size; ++i)
+    {
+        size_t j = size_t(keys[i] & 0xFFFFFFFFULL);
+        sorted.push(queue.startx[j], queue.starty[j], queue.startz[j], queue.dirx[j], queue.diry[j], queue.dirz[j],
+                    queue.coef[j], queue.refractionCoef[j], queue.slot[j]);
+    }
+    swap(queue, sorted);
+}
+
+// Secondary rays binned by the octant of their direction, then by the cell of
+// their origin along a Morton curve, in the bounding box of the origins
+static void sortByOrigin(rayQueue &paths, rayQueue &sorted, unsigned long long *keys, unsigned long long *scratch)
+{
+    if (paths.size < 2)
+        return;
+    float minx = paths.startx[0], maxx = minx;
+    float miny = paths.starty[0], maxy = miny;
+    float minz = paths.startz[0], maxz = minz;
+    for (size_t i = 1; i < paths.size; ++i)
+    {
+        minx = min(minx, paths.startx[i]); maxx = max(maxx, paths.startx[i]);
+        miny = min(miny, paths.starty[i]); maxy = max(maxy, paths.starty[i]);
+        minz = min(minz, paths.startz[i]); maxz = max(maxz, paths.startz[i]);
+    }
+    float scalex = maxx > minx ? 1.0f / (maxx - minx) : 0.0f;
+    float scaley = maxy > miny ? 1.0f / (maxy - miny) : 0.0f;
+    float scalez = maxz > minz ? 1.0f / (maxz - minz) : 0.0f;
+    for (size_t i = 0; i < paths.size; ++i)
+    {
+        unsigned int octant = (paths.dirx[i] < 0.0f ? 4 : 0) | (paths.diry[i] < 0.0f ? 2 : 0) | (paths.dirz[i] < 0.0f ? 1 : 0);
+        // 9 bits per axis, the octant takes the 3 bits left
+        unsigned int cell = mortonKey((paths.startx[i] - minx) * scalex, (paths.starty[i] - miny) * scaley,
+                                      (paths.startz[i] - minz) * scalez) >> 3;
+        keys[i] = ((unsigned long long)((octant << 27) | cell) << 32) | i;
+    }
+    sortQueue(paths, sorted, keys, scratch);
+}
+
+// Rays leaving the scene binned by direction, close directions read close texels of the cubemap
+static void sortByDirection(rayQueue &misses, rayQueue &sorted, unsigned long long *keys, unsigned long long *scratch)
+{
+    if (misses.size < 2)
+        return;
+    for (size_t i = 0; i < misses.size; ++i)
+    {
+        unsigned int key = mortonKey(0.5f * misses.dirx[i] + 0.5f, 0.5f * misses.diry[i] + 0.5f, 0.5f * misses.dirz[i] + 0.5f);
+        keys[i] = ((unsigned long long)key << 32) | i;
+    }
+    sortQueue(misses, sorted, keys, scratch);
+}
+
+static inline double secondsSince(chrono::steady_clock::time_point &start)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double seconds = chrono::duration<double>(now - start).count();
+    start = now;
+    return seconds;
+}
+
+unsigned long long wavefront::trace(scene &myScene, int maxDepth, color *results)
+{
+    unsigned long long rays = 0;
+    misses.size = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int level = 0; level < maxDepth && paths.size > 0; ++level)
+    {
+        // The primary rays of a row are coherent already
+        if (bSortRays && level > 0)
+        {
+            sortByOrigin(paths, sorted, &sortKeys[0], &sortScratch[0]);
+            times.sort += secondsSince(start);
+        }
+        rays += paths.size;
+        next.size = 0;
+        shadows.size = 0;
+        extendStage(myScene, paths, &hitT[0], &hitObject[0]);
+        times.extend += secondsSince(start);
+        shadeStage(myScene, paths, &hitT[0], &hitObject[0], next, shadows, misses);
+        times.shade += secondsSince(start);
+        rays += shadows.size;
+        shadowStage(myScene, shadows, results);
+        times.shadow += secondsSince(start);
+        swap(paths, next);
+    }
+    // The paths left after the last bounce see the cubemap too
+    for (size_t i = 0; i < paths.size; ++i)
+    {
+        misses.push(paths.startx[i], paths.starty[i], paths.startz[i], paths.dirx[i], paths.diry[i], paths.dirz[i],
+                    paths.coef[i], paths.refractionCoef[i], paths.slot[i]);
+    }
+    if (bSortRays)
+    {
+        sortByDirection(misses, sorted, &sortKeys[0], &sortScratch[0]);
+        times.sort += secondsSince(start);
+    }
+    missStage(myScene, misses, results);
+    times.miss += secondsSince(start);
+    paths.size = 0;
+    misses.size = 0;
+    return rays;
+}
@@ -0,0 +1,99 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __WAVEFRONT_H
+#define __WAVEFRONT_H
+
+// Breadth first tracing of a batch of rays (rt4 --wavefront).
+// addRay follows a single path to its end, going from the intersection tests
+// to the Fresnel terms, the shadow rays and the procedural noise at every bounce.
+// Here the paths of the whole batch move together: every stage runs over a queue
+// of rays stored as arrays of floats, before the next stage starts.
+//   extend : nearest hit of every path, blob by blob then sphere by sphere
+//   shade  : normal, Fresnel and roulette, the path continues in the next queue,
+//            or stops on a diffuse surface and queues one shadow ray per light
+//   shadow : occlusion of the shadow rays, then the lighting of the visible ones
+//   miss   : cubemap of the paths that left the scene or reached the last bounce
+// The images are the same as the ones of addRay within the sampling noise,
+// the random numbers are drawn in another order.
+
+#include <vector>
+#include <cstddef>
+#include "Def.h"
+struct ray;
+struct scene;
+
+// Paths in flight, one entry per ray
+struct rayQueue
+{
+    std::vector<float> startx, starty, startz;
+    std::vector<float> dirx, diry, dirz;
+    // Weight of the path and refraction index of the medium it goes through
+    std::vector<float> coef, refractionCoef;
+    // Result that the path adds its color to
+    std::vector<int> slot;
+    size_t size;
+
+    rayQueue() : size(0) {}
+    void reserve(size_t capacity);
+    void push(float sx, float sy, float sz, float dx, float dy, float dz, float pathCoef, float pathRefraction, int pathSlot);
+};
+
+// Shadow rays toward the lights, with what the lighting of the hit point needs
+struct shadowQueue
+{
+    std::vector<float> startx, starty, startz;
+    std::vector<float> dirx, diry, dirz;
+    // Occluders are searched up to there
+    std::vector<float> maxT;
+    std::vector<float> normalx, normaly, normalz;
+    std::vector<float> viewx, viewy, viewz;
+    std::vector<float> lightProjection, viewProjection, coef;
+    std::vector<int> materialId, lightId, slot;
+    std::vector<unsigned char> occluded;
+    size_t size;
+
+    shadowQueue() : size(0) {}
+    void reserve(size_t capacity);
+};
+
+// Seconds spent in each stage, with the sorting of the rays
+struct wavefrontTimes
+{
+    double extend, shade, shadow, sort, miss;
+    void add(const wavefrontTimes &other);
+};
+
+struct wavefront
+{
+    rayQueue paths, next, misses;
+    // Nearest hit of every path : the distance, and the sphere index,
+    // or the sphere count plus the blob index, -1 for none
+    std::vector<float> hitT;
+    std::vector<int> hitObject;
+    shadowQueue shadows;
+    // Sort the reflected and refracted rays by direction octant and origin cell
+    // before they are traced, and the misses by direction before the cubemap reads
+    bool bSortRays;
+    // Morton keys of the rays, and the queue they are sorted into
+    std::vector<unsigned long long> sortKeys, sortScratch;
+    rayQueue sorted;
+    wavefrontTimes times;
+
+    wavefront();
+
+    // Room for a batch of that many primary rays, the tracing doesn't allocate after it
+    void reserve(size_t primaryRays, size_t lightCount);
+    // Queues a primary ray, its color is added to results[slot] by trace
+    void addPrimary(const ray &viewRay, int slot);
+    // Traces the queued rays, up to maxDepth bounces, and empties the queues.
+    // Returns the number of rays traced, shadow rays included.
+    unsigned long long trace(scene &myScene, int maxDepth, color *results);
+};
+
+#endif // __WAVEFRONT_H
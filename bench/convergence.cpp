@@ -0,0 +1,162 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// Convergence of the samplers of the lens and of the roulette (see Sampler.h).
+// A reference image is rendered with many rays per fragment, then the scene is
+// rendered again with fewer rays, with the random numbers and with the Sobol
+// sequences, and we report the error of every image against the reference.
+// The error is the RMSE of the linear pixels, before the exposure, the calibration
+// rows left out. It goes down with the square root of the rays for the random
+// numbers, the gain is the number of random rays the Sobol error is worth.
+// The reference has its own seed so that its noise doesn't follow the images
+// it is compared to, what is left of it adds to the errors of both samplers.
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+
+#include "Raytrace.h"
+#include "Scene.h"
+#include "Tonemap.h"
+
+using namespace std;
+
+struct convergenceOptions
+{
+    const char *sceneName;
+    int width, height, threads;
+    int referenceRays;
+    vector<int> rays;
+    // Independent renders averaged for every error
+    int runs;
+};
+
+// Renders the linear pixels with that many rays per fragment, returns the seconds it took
+static bool render(scene &myScene, const convergenceOptions &options, int rays, bool bSobol,
+                   unsigned int seed, vector<float> &linear, double &seconds)
+{
+    myScene.complexity = rays;
+    renderOptions render;
+    render.threads = options.threads;
+    render.width = options.width;
+    render.height = options.height;
+    render.bSobol = bSobol;
+    render.seed = seed;
+    linear.resize(3 * size_t(renderWidth(myScene, render)) * renderHeight(myScene, render));
+    renderTarget target;
+    target.linear = &linear[0];
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool bOk = renderImage(myScene, render, target);
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return bOk;
+}
+
+static double rmse(const vector<float> &image, const vector<float> &reference, int width)
+{
+    size_t first = 3 * size_t(width) * calibrationRows;
+    double sum = 0.0;
+    for (size_t i = first; i < image.size(); ++i)
+        sum += double(image[i] - reference[i]) * (image[i] - reference[i]);
+    return sqrt(sum / max(size_t(1), image.size() - first));
+}
+
+static bool parseRays(const char *text, vector<int> &rays)
+{
+    rays.clear();
+    for (const char *item = text; *item; )
+    {
+        int value = atoi(item);
+        if (value < 1)
+            return false;
+        rays.push_back(value);
+        const char *comma = strchr(item, ',');
+        item = comma ? comma + 1 : item + strlen(item);
+    }
+    return !rays.empty();
+}
+
+int main(int argc, char* argv[])
+{
+    convergenceOptions options;
+    options.sceneName = "scene.txt";
+    options.width = 320;
+    options.height = 240;
+    options.threads = 0;
+    options.referenceRays = 256;
+    options.runs = 1;
+    bool bOk = parseRays("1,2,4,8,16,32", options.rays);
+    for (int i = 1; bOk && i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            options.sceneName = argv[++i];
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            options.width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+            options.height = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--reference") == 0 && i + 1 < argc)
+            options.referenceRays = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rays") == 0 && i + 1 < argc)
+            bOk = parseRays(argv[++i], options.rays);
+        else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            options.runs = atoi(argv[++i]);
+        else
+            bOk = false;
+    }
+    if (!bOk || options.width <= 0 || options.height <= calibrationRows || options.referenceRays < 1 || options.runs < 1)
+    {
+        cout << "Usage : convergence [--scene scene.txt] [--width 320] [--height 240] [--threads N]" << endl;
+        cout << "                    [--reference 256] [--rays 1,2,4,8,16,32] [--runs 1]" << endl;
+        return -1;
+    }
+
+    scene myScene;
+    if (!init(const_cast<char *>(options.sceneName), myScene))
+    {
+        cout << "Failure when reading the Scene file." << endl;
+        return -1;
+    }
+
+    // The Sobol sequences converge faster, the reference is closer to the limit with them
+    vector<float> reference, image;
+    double seconds;
+    if (!render(myScene, options, options.referenceRays, true, 0xFFFFFFFFU, reference, seconds))
+    {
+        cout << "Failure when rendering the reference image." << endl;
+        return -1;
+    }
+    printf("%s at %dx%d, reference of %d rays per fragment in %.2f s\n\n", options.sceneName,
+           options.width, options.height, options.referenceRays, seconds);
+    printf("%6s %12s %9s %12s %9s %8s\n", "rays", "random RMSE", "s", "sobol RMSE", "s", "gain");
+    for (size_t r = 0; r < options.rays.size(); ++r)
+    {
+        double errors[2] = {0.0, 0.0}, times[2] = {0.0, 0.0};
+        for (int sampler = 0; sampler < 2; ++sampler)
+        for (int run = 0; run < options.runs; ++run)
+        {
+            if (!render(myScene, options, options.rays[r], sampler == 1, run, image, seconds))
+            {
+                cout << "Failure when rendering the image." << endl;
+                return -1;
+            }
+            errors[sampler] += rmse(image, reference, options.width) / options.runs;
+            times[sampler] += seconds / options.runs;
+        }
+        // The random error goes as 1 / sqrt(rays)
+        double gain = errors[1] > 0.0 ? (errors[0] / errors[1]) * (errors[0] / errors[1]) : 0.0;
+        printf("%6d %12.5f %9.3f %12.5f %9.3f %7.2fx\n", options.rays[r], errors[0], times[0],
+               errors[1], times[1], gain);
+    }
+    return 0;
+}
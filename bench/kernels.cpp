@@ -0,0 +1,562 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// Micro-benchmarks of the ray tracing hot paths.
+// Every kernel runs over a fixed set of inputs generated from a constant seed,
+// so that two runs (or two builds) measure exactly the same work.
+// The process is pinned to one CPU, each kernel is warmed up, then timed
+// over a number of samples. We report the mean time per operation with its 95%
+// confidence interval, and optionally write all the results as JSON.
+// With --perf, the hardware counters per operation come along (see PerfCounters.h).
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "Raytrace.h"
+#include "Scene.h"
+#include "Blob.h"
+#include "Perlin.h"
+#include "Texture.h"
+#include "Srgb.h"
+#include "PerfCounters.h"
+
+using namespace std;
+
+// Fixed size of every input set
+const unsigned int inputSize = 4096;
+
+// Minimum duration of one timed sample, shorter samples are dominated by the clock
+const double minSampleNs = 10e6;
+
+// The results are accumulated here so that the compiler can't drop the kernels
+static volatile float benchSink;
+
+// Same LCG as the scene generator, the inputs must not depend on the C library
+struct benchRandom
+{
+    unsigned int seed;
+    benchRandom(unsigned int s) : seed(s) {}
+    float range(float a, float b)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        return a + (b - a) * float(seed >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+struct benchResult
+{
+    SimpleString name;
+    double nsPerOp;
+    double ci95;
+    double minNsPerOp;
+    double raysPerOp;
+    int samples;
+    unsigned long long opsPerSample;
+    // Hardware counters per operation over all the samples, negative when unavailable
+    double countersPerOp[perfCounters::counterCount];
+};
+
+struct benchOptions
+{
+    int samples;
+    bool bPerf;
+    const char *filter;
+    const char *jsonName;
+    const char *sceneName;
+};
+
+// Two sided 95% quantiles of the Student distribution, for 1 to 30 degrees of freedom
+static double studentQuantile(int degrees)
+{
+    static const double table[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+    if (degrees < 1)
+        return 0.0;
+    if (degrees <= 30)
+        return table[degrees - 1];
+    return 1.96;
+}
+
+// Runs kernel(i) for every input, nbPasses times, and returns the elapsed time in ns
+template <class Kernel>
+static double timePasses(Kernel &kernel, unsigned int nbPasses)
+{
+    float sum = 0.0f;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (unsigned int pass = 0; pass < nbPasses; ++pass)
+    {
+        for (unsigned int i = 0; i < kernel.size(); ++i)
+        {
+            sum += kernel(i);
+        }
+    }
+    double elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    benchSink = sum;
+    return elapsed;
+}
+
+template <class Kernel>
+static void runBench(const char *name, Kernel &kernel, double raysPerOp,
+                     const benchOptions &options, vector<benchResult> &results)
+{
+    if (options.filter && !strstr(name, options.filter))
+        return;
+
+    // Calibration : find how many passes make a long enough sample.
+    // This also acts as the first warm-up run.
+    unsigned int nbPasses = 1;
+    while (timePasses(kernel, nbPasses) < minSampleNs && nbPasses < (1U << 20))
+        nbPasses *= 2;
+    // Additional warm-up, caches, branch predictors and the cpu frequency settle here
+    for (int i = 0; i < 3; ++i)
+        timePasses(kernel, nbPasses);
+
+    const double opsPerSample = double(nbPasses) * kernel.size();
+    vector<double> samples(options.samples);
+    double mean = 0.0, minimum = 0.0;
+    perfCounters startCounters, endCounters;
+    if (options.bPerf)
+        perfRead(startCounters);
+    for (int i = 0; i < options.samples; ++i)
+    {
+        samples[i] = timePasses(kernel, nbPasses) / opsPerSample;
+        mean += samples[i];
+        if (i == 0 || samples[i] < minimum)
+            minimum = samples[i];
+    }
+    if (options.bPerf)
+        perfRead(endCounters);
+    mean /= options.samples;
+    double variance = 0.0;
+    for (int i = 0; i < options.samples; ++i)
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    if (options.samples > 1)
+        variance /= options.samples - 1;
+
+    benchResult result;
+    result.name = name;
+    result.nsPerOp = mean;
+    result.ci95 = studentQuantile(options.samples - 1) * sqrt(variance / options.samples);
+    result.minNsPerOp = minimum;
+    result.raysPerOp = raysPerOp;
+    result.samples = options.samples;
+    result.opsPerSample = (unsigned long long) opsPerSample;
+    for (int i = 0; i < perfCounters::counterCount; ++i)
+    {
+        if (!options.bPerf || startCounters.values[i] < 0 || endCounters.values[i] < 0)
+            result.countersPerOp[i] = -1.0;
+        else
+            result.countersPerOp[i] = double(endCounters.values[i] - startCounters.values[i]) 
+                                    / (opsPerSample * options.samples);
+    }
+    results.push_back(result);
+
+    cout.setf(ios::fixed);
+    cout.precision(2);
+    cout << name;
+    for (size_t i = strlen(name); i < 24; ++i)
+        cout << ' ';
+    cout << result.nsPerOp << " ns/op +- " << result.ci95 << " (min " << result.minNsPerOp << ")";
+    if (raysPerOp > 0.0)
+    {
+        cout.precision(3);
+        cout << "  " << raysPerOp * 1e3 / result.nsPerOp << " Mrays/s";
+    }
+    cout << endl;
+    if (options.bPerf && result.countersPerOp[perfCounters::cycles] >= 0.0)
+    {
+        // Tells whether a kernel is compute bound (high IPC) or waits on memory (misses)
+        const double *c = result.countersPerOp;
+        cout.precision(2);
+        cout << "                        " << c[perfCounters::cycles] << " cycles/op";
+        if (c[perfCounters::instructions] >= 0.0)
+            cout << ", IPC " << c[perfCounters::instructions] / c[perfCounters::cycles];
+        for (int i = perfCounters::l1dMisses; i <= perfCounters::branchMisses; ++i)
+            if (c[i] >= 0.0)
+                cout << ", " << c[i] << " " << perfCounterName(i) << "/op";
+        cout << endl;
+    }
+}
+
+// Rays from the camera position of scene.txt toward a box around the objects,
+// roughly half of them hit something
+static void makeRays(vector<ray> &rays, unsigned int seed, const point &center, float extent)
+{
+    benchRandom random(seed);
+    rays.resize(inputSize);
+    for (unsigned int i = 0; i < inputSize; ++i)
+    {
+        point start = {320.0f, 240.0f, 0.0f};
+        point target;
+        target.x = random.range(center.x - extent, center.x + extent);
+        target.y = random.range(center.y - extent, center.y + extent);
+        target.z = random.range(center.z - extent, center.z + extent);
+        vecteur dir = target - start;
+        dir = invsqrtf(dir * dir) * dir;
+        rays[i].start = start;
+        rays[i].dir = dir;
+    }
+}
+
+static void makePoints(vector<point> &points, unsigned int seed, float extent)
+{
+    benchRandom random(seed);
+    points.resize(inputSize);
+    for (unsigned int i = 0; i < inputSize; ++i)
+    {
+        points[i].x = random.range(0.0f, extent);
+        points[i].y = random.range(0.0f, extent);
+        points[i].z = random.range(0.0f, extent);
+    }
+}
+
+struct hitSphereKernel
+{
+    vector<ray> rays;
+    sphere s;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i)
+    {
+        float t = 2000.0f;
+        return hitSphere(rays[i], s, t) ? t : 0.0f;
+    }
+};
+
+struct blobKernel
+{
+    vector<ray> rays;
+    blob b;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i)
+    {
+        float t = 2000.0f;
+        return isBlobIntersected(rays[i], b, t) ? t : 0.0f;
+    }
+};
+
+struct blobInterpolationKernel
+{
+    vector<point> points;
+    blob b;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i)
+    {
+        vecteur normal;
+        blobInterpolation(points[i], b, normal);
+        return normal.x;
+    }
+};
+
+struct noiseKernel
+{
+    vector<point> points;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i)
+    {
+        return noisef(points[i].x, points[i].y, points[i].z);
+    }
+};
+
+struct turbulenceKernel
+{
+    vector<point> points;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i) { return turbulenceNoise(points[i]); }
+};
+
+struct marbleKernel
+{
+    vector<point> points;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i) { return marbleNoise(points[i]); }
+};
+
+struct cubemapKernel
+{
+    vector<ray> rays;
+    const cubemap *cm;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i) { return readCubemap(*cm, rays[i]).red; }
+};
+
+struct textureKernel
+{
+    vector<color> texels;
+    vector<point> coords;
+    int sizeU, sizeV;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i)
+    {
+        return readTexture(&texels[0], coords[i].x, coords[i].y, sizeU, sizeV).green;
+    }
+};
+
+struct srgbKernel
+{
+    vector<float> values;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i) { return srgbEncode(values[i]); }
+};
+
+struct addRayKernel
+{
+    vector<ray> rays;
+    scene *myScene;
+    unsigned int size() const { return inputSize; }
+    float operator()(unsigned int i)
+    {
+        // Reseed the roulette of addRay so that every pass traces the same paths
+        if (i == 0)
+            seedRandom(1);
+        color result = addRay(rays[i], *myScene, context::getDefaultAir());
+        return result.red + result.green + result.blue;
+    }
+};
+
+static void pinCpu(int &cpu)
+{
+    cpu = -1;
+#ifdef __linux__
+    cpu = sched_getcpu();
+    if (cpu < 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        cpu = -1;
+#endif
+}
+
+static bool writeJson(const char *fileName, int cpu, const vector<benchResult> &results)
+{
+    ofstream jsonFile(fileName);
+    if (!jsonFile)
+        return false;
+    jsonFile.precision(6);
+    jsonFile << "{\n  \"cpu\": " << cpu << ",\n  \"pinned\": " << (cpu >= 0 ? "true" : "false")
+             << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const benchResult &r = results[i];
+        jsonFile << "    {\"name\": \"" << r.name.c_str() << "\", \"ns_per_op\": " << r.nsPerOp
+                 << ", \"ci95\": " << r.ci95 << ", \"min_ns_per_op\": " << r.minNsPerOp
+                 << ", \"samples\": " << r.samples << ", \"ops_per_sample\": " << r.opsPerSample;
+        if (r.raysPerOp > 0.0)
+            jsonFile << ", \"rays_per_s\": " << r.raysPerOp * 1e9 / r.nsPerOp;
+        for (int k = 0; k < perfCounters::counterCount; ++k)
+        {
+            if (r.countersPerOp[k] < 0.0)
+                continue;
+            SimpleString key(perfCounterName(k));
+            for (SimpleString::iterator it = key.begin(); it != key.end(); ++it)
+                if (*it == ' ')
+                    *it = '_';
+            jsonFile << ", \"" << key.c_str() << "_per_op\": " << r.countersPerOp[k];
+        }
+        jsonFile << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    jsonFile << "  ]\n}\n";
+    return bool(jsonFile);
+}
+
+int main(int argc, char* argv[])
+{
+    benchOptions options = { 30, false, NULL, NULL, "scene.txt" };
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+            options.samples = max(2, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--perf") == 0)
+            options.bPerf = true;
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            options.jsonName = argv[++i];
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+            options.sceneName = argv[++i];
+        else
+        {
+            cout << "Usage : kernels [--samples N] [--perf] [--filter name] [--json results.json] [--scene Scene.txt]" << endl;
+            return -1;
+        }
+    }
+
+    int cpu;
+    pinCpu(cpu);
+    if (cpu < 0)
+        cout << "Could not pin the benchmark to a cpu, results may be noisier." << endl;
+    // The kernels run on this thread only
+    if (options.bPerf && !perfEnable())
+        options.bPerf = false;
+
+    scene myScene;
+    if (!init(const_cast<char *>(options.sceneName), myScene))
+    {
+        cout << "Failure when reading the Scene file." << endl;
+        return -1;
+    }
+    // The blob kernels need the zones even if the scene has no blob
+    initBlobZones();
+
+    vector<benchResult> results;
+    const point sceneCenter = {320.0f, 240.0f, 400.0f};
+
+    {
+        hitSphereKernel kernel;
+        makeRays(kernel.rays, 1, sceneCenter, 200.0f);
+        sphere s = {{400.0f, 290.0f, 320.0f}, 100.0f, 0};
+        kernel.s = s;
+        runBench("hitSphere", kernel, 1.0, options, results);
+    }
+
+    static const int blobCenters[] = {3, 8, 32};
+    for (int n = 0; n < 3; ++n)
+    {
+        // Centers spread in a volume that grows with their number
+        // so that the blob keeps a similar density
+        benchRandom random(100 + n);
+        blob b;
+        float extent = 120.0f * cbrtf(blobCenters[n] / 3.0f);
+        for (int i = 0; i < blobCenters[n]; ++i)
+        {
+            point center;
+            center.x = random.range(sceneCenter.x - extent, sceneCenter.x + extent);
+            center.y = random.range(sceneCenter.y - extent, sceneCenter.y + extent);
+            center.z = random.range(sceneCenter.z - extent, sceneCenter.z + extent);
+            b.centerList.push_back(center);
+        }
+        b.size = 80.0f;
+        b.invSizeSquare = 1.0f / (b.size * b.size);
+        b.materialId = 0;
+
+        blobKernel kernel;
+        makeRays(kernel.rays, 2, sceneCenter, extent + b.size);
+        kernel.b = b;
+        SimpleString name("isBlobIntersected/");
+        name.append((unsigned long) blobCenters[n]);
+        runBench(name.c_str(), kernel, 1.0, options, results);
+
+        if (blobCenters[n] == 8)
+        {
+            blobInterpolationKernel interpolation;
+            makePoints(interpolation.points, 3, 640.0f);
+            interpolation.b = b;
+            runBench("blobInterpolation/8", interpolation, 0.0, options, results);
+        }
+    }
+
+    {
+        noiseKernel kernel;
+        makePoints(kernel.points, 4, 64.0f);
+        runBench("noise", kernel, 0.0, options, results);
+    }
+    {
+        turbulenceKernel kernel;
+        makePoints(kernel.points, 5, 640.0f);
+        runBench("turbulence", kernel, 0.0, options, results);
+    }
+    {
+        marbleKernel kernel;
+        makePoints(kernel.points, 6, 640.0f);
+        runBench("marble", kernel, 0.0, options, results);
+    }
+    if (myScene.cm.texture)
+    {
+        cubemapKernel kernel;
+        // Directions over the whole sphere, so that all faces are read
+        benchRandom random(7);
+        kernel.rays.resize(inputSize);
+        for (unsigned int i = 0; i < inputSize; ++i)
+        {
+            point start = {0.0f, 0.0f, 0.0f};
+            vecteur dir;
+            dir.x = random.range(-1.0f, 1.0f);
+            dir.y = random.range(-1.0f, 1.0f);
+            dir.z = random.range(-1.0f, 1.0f);
+            kernel.rays[i].start = start;
+            kernel.rays[i].dir = dir;
+        }
+        kernel.cm = &myScene.cm;
+        runBench("readCubemap", kernel, 0.0, options, results);
+    }
+    else
+    {
+        cout << "No skybox in the scene, skipping readCubemap." << endl;
+    }
+    {
+        textureKernel kernel;
+        kernel.sizeU = kernel.sizeV = 512;
+        benchRandom random(8);
+        kernel.texels.resize(kernel.sizeU * kernel.sizeV);
+        for (size_t i = 0; i < kernel.texels.size(); ++i)
+        {
+            kernel.texels[i].red = random.range(0.0f, 1.0f);
+            kernel.texels[i].green = random.range(0.0f, 1.0f);
+            kernel.texels[i].blue = random.range(0.0f, 1.0f);
+        }
+        makePoints(kernel.coords, 9, 1.0f);
+        runBench("readTexture", kernel, 0.0, options, results);
+    }
+    {
+        srgbKernel kernel;
+        benchRandom random(10);
+        kernel.values.resize(inputSize);
+        for (unsigned int i = 0; i < inputSize; ++i)
+            kernel.values[i] = random.range(0.0f, 1.0f);
+        runBench("srgbEncode", kernel, 0.0, options, results);
+    }
+    {
+        // Primary rays of the scene camera, on a regular grid over the image
+        addRayKernel kernel;
+        kernel.myScene = &myScene;
+        kernel.rays.resize(inputSize);
+        const int gridX = 64, gridY = inputSize / 64;
+        for (int y = 0; y < gridY; ++y)
+        for (int x = 0; x < gridX; ++x)
+        {
+            float fragmentx = (x + 0.5f) * myScene.sizex / gridX;
+            float fragmenty = (y + 0.5f) * myScene.sizey / gridY;
+            ray &viewRay = kernel.rays[y * gridX + x];
+            if (myScene.persp.type == perspective::orthogonal)
+            {
+                point start = {fragmentx, fragmenty, -10000.0f};
+                vecteur dir = {0.0f, 0.0f, 1.0f};
+                viewRay.start = start;
+                viewRay.dir = dir;
+            }
+            else
+            {
+                vecteur dir = {(fragmentx - 0.5f * myScene.sizex) * myScene.persp.invProjectionDistance,
+                               (fragmenty - 0.5f * myScene.sizey) * myScene.persp.invProjectionDistance,
+                               1.0f};
+                point start = {0.5f * myScene.sizex,  0.5f * myScene.sizey, 0.0f};
+                viewRay.start = start;
+                viewRay.dir = invsqrtf(dir * dir) * dir;
+            }
+        }
+        runBench("addRay", kernel, 1.0, options, results);
+    }
+
+    if (options.jsonName && !writeJson(options.jsonName, cpu, results))
+    {
+        cout << "Failure when writing the results file." << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// Load time benchmark of the scene file parser.
+// It writes a synthetic scene with a large number of spheres
+// then times the parsing and the lookups that init() would do,
+// the whole text scene loading, and the loading of the compiled scene.
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <chrono>
+#include "Config.h"
+#include "Scene.h"
+
+using namespace std;
+
+static double elapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+static bool writeScene(const char *fileName, int nbSpheres)
+{
+    ofstream sceneFile(fileName);
+    if (!sceneFile)
+        return false;
+    sceneFile << "// Synthetic scene for the load time benchmark\n"
+              << "Scene\n{\n  Version.Major = 1;\n  Version.Minor = 3;\n"
+              << "  NumberOfMaterials = 1;\n  NumberOfSpheres = " << nbSpheres << ";\n}\n"
+              << "Material0\n{\n  Type = gouraud;\n  Diffuse = 0.5, 0.5, 0.5;\n}\n";
+    unsigned int seed = 1;
+    for (int i = 0; i < nbSpheres; ++i)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        sceneFile << "Sphere" << i << "\n{\n"
+                  << "  Center = " << (seed % 6400) * 0.1f << ", " << (seed / 7 % 4800) * 0.1f 
+                  << ", " << (seed / 13 % 10000) * 0.1f << ";\n"
+                  << "  Size = " << (seed / 17 % 500) * 0.1f + 1.0f << ";\n"
+                  << "  Material.Id = 0;\n}\n";
+    }
+    return bool(sceneFile);
+}
+
+int main(int argc, char* argv[])
+{
+    int nbSpheres = (argc > 1) ? atoi(argv[1]) : 500000;
+    const char *fileName = (argc > 2) ? argv[2] : "sceneload.txt";
+
+    if (!writeScene(fileName, nbSpheres))
+    {
+        cout << "Failure when writing the synthetic scene file." << endl;
+        return -1;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Config sceneFile(fileName);
+    if (sceneFile.SetSection("Scene") == -1)
+    {
+        cout << "Failure when parsing the synthetic scene file." << endl;
+        return -1;
+    }
+    double parseTime = elapsedMs(start);
+
+    start = chrono::steady_clock::now();
+    const point origin = {0.0f, 0.0f, 0.0f};
+    float checksum = 0.0f;
+    int nbRead = sceneFile.GetByNameAsInteger("NumberOfSpheres", 0);
+    for (int i = 0; i < nbRead; ++i)
+    {
+        SimpleString sectionName("Sphere");
+        sectionName.append((unsigned long) i);
+        if (sceneFile.SetSection(sectionName) == -1)
+        {
+            cout << "Missing Sphere section." << endl;
+            return -1;
+        }
+        point center = sceneFile.GetByNameAsPoint("Center", origin);
+        checksum += center.x + float(sceneFile.GetByNameAsFloat("Size", 0.0f)) 
+                  + sceneFile.GetByNameAsInteger("Material.Id", 0);
+    }
+    double lookupTime = elapsedMs(start);
+
+    cout << nbRead << " spheres, parse " << parseTime << " ms, lookups " 
+         << lookupTime << " ms (checksum " << checksum << ")" << endl;
+
+    SimpleString binaryName(fileName);
+    binaryName.append(".rtb");
+    {
+        start = chrono::steady_clock::now();
+        scene myScene;
+        if (!parseScene(const_cast<char *>(fileName), myScene))
+            return -1;
+        cout << "text scene loaded in " << elapsedMs(start) << " ms" << endl;
+    }
+    if (!compileScene(const_cast<char *>(fileName), const_cast<char *>(binaryName.c_str())))
+        return -1;
+    {
+        start = chrono::steady_clock::now();
+        scene myScene;
+        if (!loadBinaryScene(binaryName.c_str(), myScene))
+            return -1;
+        cout << "compiled scene loaded in " << elapsedMs(start) << " ms" << endl;
+    }
+    remove(binaryName.c_str());
+    remove(fileName);
+    return 0;
+}
@@ -0,0 +1,384 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// End to end throughput benchmark of rt4.
+// Every scene is rendered at several image sizes and thread counts by running
+// the rt4 executable itself, so that we measure exactly what a user gets.
+// We report the rays per second and the render time that rt4 prints with --stats,
+// the wall clock time of the whole process (seconds per frame, loading included),
+// its peak resident memory, and the strong and weak scaling efficiencies.
+// The results can be compared against a baseline, written in the same syntax
+// as the scene files, and the benchmark fails when a run regressed by more
+// than the threshold.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "Config.h"
+
+using namespace std;
+
+struct throughputRun
+{
+    SimpleString sceneName;
+    int width, height, threads;
+    double renderSeconds;
+    double wallSeconds;
+    unsigned long long rays;
+    long peakRssKb;
+    double mraysPerSecond() const { return rays * 1e-6 / renderSeconds; }
+};
+
+struct throughputOptions
+{
+    const char *rt4;
+    vector<SimpleString> scenes;
+    vector<int> widths, heights;
+    vector<int> threads;
+    int repeat;
+    const char *baselineName;
+    bool bUpdateBaseline;
+    double threshold;
+};
+
+static double elapsedSeconds(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Runs rt4 once, returns false if it couldn't run or didn't print its statistics
+static bool runRt4(const throughputOptions &options, throughputRun &run)
+{
+    char threads[16], width[16], height[16];
+    sprintf(threads, "%d", run.threads);
+    sprintf(width, "%d", run.width);
+    sprintf(height, "%d", run.height);
+    const char *args[] = { options.rt4, "--stats", "--threads", threads, "--width", width,
+                           "--height", height, run.sceneName.c_str(), "/dev/null", NULL };
+
+    int output[2];
+    if (pipe(output) != 0)
+        return false;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(output[0]);
+        close(output[1]);
+        return false;
+    }
+    if (pid == 0)
+    {
+        dup2(output[1], 1);
+        close(output[0]);
+        close(output[1]);
+        execv(options.rt4, const_cast<char * const *>(args));
+        _exit(127);
+    }
+    close(output[1]);
+    SimpleString text;
+    char buffer[4096];
+    ssize_t nbRead;
+    while ((nbRead = read(output[0], buffer, sizeof(buffer))) > 0)
+        text.append(buffer, int(nbRead));
+    close(output[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid)
+        return false;
+    run.wallSeconds = elapsedSeconds(start);
+    // Linux reports it in kilobytes
+    run.peakRssKb = usage.ru_maxrss;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        cout << text.c_str();
+        return false;
+    }
+
+    const char *stats = strstr(text.c_str(), "Rendered ");
+    int nbThreads;
+    if (!stats || sscanf(stats, "Rendered %dx%d with %d threads in %lf s, %llu rays",
+                         &run.width, &run.height, &nbThreads, &run.renderSeconds, &run.rays) != 5)
+        return false;
+    return run.renderSeconds > 0.0;
+}
+
+// Best of several runs, the slower ones only measure the noise of the machine
+static bool measure(const throughputOptions &options, const SimpleString &sceneName,
+                    int width, int height, int threads, throughputRun &best)
+{
+    for (int i = 0; i < options.repeat; ++i)
+    {
+        throughputRun run;
+        run.sceneName = sceneName;
+        run.width = width;
+        run.height = height;
+        run.threads = threads;
+        if (!runRt4(options, run))
+        {
+            cout << "Failure when running " << options.rt4 << " on " << sceneName.c_str() << endl;
+            return false;
+        }
+        if (i == 0 || run.renderSeconds < best.renderSeconds)
+        {
+            long peakRssKb = (i == 0) ? run.peakRssKb : max(best.peakRssKb, run.peakRssKb);
+            best = run;
+            best.peakRssKb = peakRssKb;
+        }
+        else
+        {
+            best.peakRssKb = max(best.peakRssKb, run.peakRssKb);
+        }
+    }
+    return true;
+}
+
+// Name of the baseline section of a run, such as Run.small.640x480.4
+static SimpleString baselineSection(const throughputRun &run)
+{
+    const char *name = run.sceneName.c_str();
+    const char *slash = strrchr(name, '/');
+    if (slash)
+        name = slash + 1;
+    SimpleString section("Run.");
+    for (; *name && *name != '.'; ++name)
+    {
+        char c = *name;
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')))
+            c = '_';
+        section.append(c);
+    }
+    section.append(".");
+    section.append(run.width).append('x').append(run.height).append('.').append(run.threads);
+    return section;
+}
+
+// The weak scaling runs may repeat a strong scaling one, the baseline keeps the first
+static void addRun(vector<throughputRun> &runs, const throughputRun &run)
+{
+    SimpleString section = baselineSection(run);
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        if (strcmp(baselineSection(runs[i]).c_str(), section.c_str()) == 0)
+            return;
+    }
+    runs.push_back(run);
+}
+
+static bool writeBaseline(const char *fileName, const vector<throughputRun> &runs)
+{
+    ofstream baselineFile(fileName);
+    if (!baselineFile)
+        return false;
+    baselineFile << "// Throughput baseline, written by bench/throughput --update-baseline\n";
+    for (size_t i = 0; i < runs.size(); ++i)
+    {
+        const throughputRun &run = runs[i];
+        baselineFile << "\n" << baselineSection(run).c_str() << "\n{\n"
+                     << "  Scene = " << run.sceneName.c_str() << ";\n"
+                     << "  MraysPerSecond = " << run.mraysPerSecond() << ";\n"
+                     << "  SecondsPerFrame = " << run.wallSeconds << ";\n"
+                     << "  PeakRss = " << run.peakRssKb << ";\n}\n";
+    }
+    return bool(baselineFile);
+}
+
+static void printRun(const throughputRun &run, double efficiency, Config *baseline,
+                     double threshold, int &nbRegressions)
+{
+    printf("%-22s %5dx%-5d %3d %9.3f %9.3f %10.3f %8ld %7.1f%%",
+           run.sceneName.c_str(), run.width, run.height, run.threads,
+           run.mraysPerSecond(), run.renderSeconds, run.wallSeconds,
+           run.peakRssKb / 1024, 100.0 * efficiency);
+    if (baseline && baseline->SetSection(baselineSection(run)) != -1)
+    {
+        double baseMrays = baseline->GetByNameAsFloat("MraysPerSecond", 0.0);
+        double baseRss = baseline->GetByNameAsFloat("PeakRss", 0.0);
+        double raysChange = baseMrays > 0.0 ? run.mraysPerSecond() / baseMrays - 1.0 : 0.0;
+        double rssChange = baseRss > 0.0 ? run.peakRssKb / baseRss - 1.0 : 0.0;
+        bool bRegressed = raysChange < -threshold || rssChange > threshold;
+        printf(" %+7.1f%% %+7.1f%%%s", 100.0 * raysChange, 100.0 * rssChange,
+               bRegressed ? "  REGRESSION" : "");
+        if (bRegressed)
+            ++nbRegressions;
+    }
+    printf("\n");
+}
+
+static void printHeader(const char *title, bool bBaseline)
+{
+    printf("\n%s\n%-22s %11s %3s %9s %9s %10s %8s %8s%s\n", title, "scene", "size", "thr",
+           "Mrays/s", "render s", "s/frame", "RSS MB", "eff", bBaseline ? "   rays    RSS" : "");
+}
+
+template <class T>
+static bool parseList(const char *text, vector<T> &values, T (*parse)(const char *))
+{
+    values.clear();
+    while (*text)
+    {
+        const char *end = strchr(text, ',');
+        if (!end)
+            end = text + strlen(text);
+        SimpleString item(text, int(end - text));
+        values.push_back(parse(item.c_str()));
+        text = *end ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+static int parseInt(const char *text) { return atoi(text); }
+static SimpleString parseName(const char *text) { return SimpleString(text); }
+
+static bool parseSizes(const char *text, throughputOptions &options)
+{
+    vector<SimpleString> sizes;
+    if (!parseList(text, sizes, parseName))
+        return false;
+    options.widths.clear();
+    options.heights.clear();
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        int width, height;
+        if (sscanf(sizes[i].c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+            return false;
+        options.widths.push_back(width);
+        options.heights.push_back(height);
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    throughputOptions options;
+    options.rt4 = "./rt4";
+    options.repeat = 3;
+    options.baselineName = NULL;
+    options.bUpdateBaseline = false;
+    options.threshold = 0.1;
+    bool bOk = parseList("scenes/small.txt", options.scenes, parseName)
+            && parseSizes("320x240,640x480", options)
+            && parseList("1,2,4", options.threads, parseInt);
+    for (int i = 1; bOk && i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--rt4") == 0 && i + 1 < argc)
+            options.rt4 = argv[++i];
+        else if (strcmp(argv[i], "--scenes") == 0 && i + 1 < argc)
+            bOk = parseList(argv[++i], options.scenes, parseName);
+        else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+            bOk = parseSizes(argv[++i], options);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            bOk = parseList(argv[++i], options.threads, parseInt);
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            options.repeat = max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            options.baselineName = argv[++i];
+        else if (strcmp(argv[i], "--update-baseline") == 0)
+            options.bUpdateBaseline = true;
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            options.threshold = atof(argv[++i]);
+        else
+            bOk = false;
+    }
+    sort(options.threads.begin(), options.threads.end());
+    if (!bOk || options.threads[0] < 1)
+    {
+        cout << "Usage : throughput [--rt4 ./rt4] [--scenes a.txt,b.txt] [--sizes 320x240,640x480]" << endl;
+        cout << "                   [--threads 1,2,4] [--repeat 3] [--baseline file]" << endl;
+        cout << "                   [--update-baseline] [--threshold 0.1]" << endl;
+        return -1;
+    }
+
+    // An existing baseline is compared against, a missing one is created
+    Config *baseline = NULL;
+    if (options.baselineName && !options.bUpdateBaseline)
+    {
+        if (access(options.baselineName, R_OK) == 0)
+            baseline = new Config(options.baselineName);
+        else
+            options.bUpdateBaseline = true;
+    }
+
+    vector<throughputRun> runs;
+    int nbRegressions = 0;
+    const int refThreads = options.threads[0];
+
+    // Strong scaling : same image, more threads.
+    // The efficiency is the speedup over the smallest thread count, divided by the thread ratio.
+    printHeader("Strong scaling", baseline != NULL);
+    for (size_t s = 0; s < options.scenes.size(); ++s)
+    for (size_t r = 0; r < options.widths.size(); ++r)
+    {
+        throughputRun reference;
+        for (size_t t = 0; t < options.threads.size(); ++t)
+        {
+            throughputRun run;
+            if (!measure(options, options.scenes[s], options.widths[r], options.heights[r],
+                         options.threads[t], run))
+                return -1;
+            if (t == 0)
+                reference = run;
+            double efficiency = (reference.renderSeconds * refThreads) / (run.renderSeconds * run.threads);
+            printRun(run, efficiency, baseline, options.threshold, nbRegressions);
+            addRun(runs, run);
+        }
+    }
+
+    // Weak scaling : the number of pixels grows with the number of threads,
+    // starting from the first image size. The efficiency compares the rays per second
+    // per thread, because the work per pixel isn't uniform.
+    printHeader("Weak scaling", baseline != NULL);
+    for (size_t s = 0; s < options.scenes.size(); ++s)
+    {
+        throughputRun reference;
+        for (size_t t = 0; t < options.threads.size(); ++t)
+        {
+            double ratio = sqrt(double(options.threads[t]) / refThreads);
+            int width = int(options.widths[0] * ratio + 0.5);
+            int height = int(options.heights[0] * ratio + 0.5);
+            throughputRun run;
+            if (!measure(options, options.scenes[s], width, height, options.threads[t], run))
+                return -1;
+            if (t == 0)
+                reference = run;
+            double efficiency = (run.mraysPerSecond() / run.threads)
+                              / (reference.mraysPerSecond() / refThreads);
+            printRun(run, efficiency, baseline, options.threshold, nbRegressions);
+            addRun(runs, run);
+        }
+    }
+    delete baseline;
+
+    if (options.baselineName && options.bUpdateBaseline)
+    {
+        if (!writeBaseline(options.baselineName, runs))
+        {
+            cout << "Failure when writing the baseline file." << endl;
+            return -1;
+        }
+        cout << "\nBaseline written to " << options.baselineName << endl;
+    }
+    if (nbRegressions)
+    {
+        cout << "\n" << nbRegressions << " run(s) regressed by more than "
+             << 100.0 * options.threshold << "% against the baseline." << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// C interface of librt4, see rt4.h
+
+#include "rt4.h"
+#include "Raytrace.h"
+#include "Scene.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <atomic>
+#include <iostream>
+#include <algorithm>
+using namespace std;
+
+struct rt4_scene
+{
+    scene myScene;
+};
+
+static color toColor(const float rgb[3])
+{
+    color result = {rgb[0], rgb[1], rgb[2]};
+    return result;
+}
+
+static point toPoint(const float xyz[3])
+{
+    point result = {xyz[0], xyz[1], xyz[2]};
+    return result;
+}
+
+rt4_scene *rt4_scene_load(const char *fileName)
+{
+    if (!fileName)
+        return NULL;
+    rt4_scene *newScene = new rt4_scene;
+    vector<char> name(fileName, fileName + strlen(fileName) + 1);
+    if (!init(&name[0], newScene->myScene))
+    {
+        delete newScene;
+        return NULL;
+    }
+    return newScene;
+}
+
+rt4_scene *rt4_scene_parse(const char *text, size_t size)
+{
+    if (!text)
+        return NULL;
+    rt4_scene *newScene = new rt4_scene;
+    if (!initInline(text, size, newScene->myScene))
+    {
+        delete newScene;
+        return NULL;
+    }
+    return newScene;
+}
+
+rt4_scene *rt4_scene_create(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return NULL;
+    rt4_scene *newScene = new rt4_scene;
+    scene &myScene = newScene->myScene;
+    myScene.sizex = width;
+    myScene.sizey = height;
+    myScene.complexity = 1;
+    myScene.maxDepth = 10;
+    myScene.persp.type = perspective::orthogonal;
+    myScene.persp.FOV = 0.0f;
+    myScene.persp.clearPoint = 0.0f;
+    myScene.persp.dispersion = 0.0f;
+    myScene.persp.invProjectionDistance = 0.0f;
+    // Same defaults as readTonemapSettings
+    tonemapSettings defaultTonemap = {tonemapSettings::rms, 0.0f, 0.6f, 3.0f, 0.1f, 0.0f, false, 0.75f};
+    myScene.tonemap = defaultTonemap;
+    setupTonemap(myScene.tonemap);
+    return newScene;
+}
+
+void rt4_scene_free(rt4_scene *scene)
+{
+    delete scene;
+}
+
+void rt4_scene_size(const rt4_scene *scene, int *width, int *height)
+{
+    if (width)
+        *width = scene ? scene->myScene.sizex : 0;
+    if (height)
+        *height = scene ? scene->myScene.sizey : 0;
+}
+
+void rt4_scene_animate(rt4_scene *scene, int frame)
+{
+    if (scene)
+        animateScene(scene->myScene, frame);
+}
+
+int rt4_scene_add_material(rt4_scene *scene, const rt4_material *newMaterial)
+{
+    if (!scene || !newMaterial || newMaterial->type < RT4_MATERIAL_GOURAUD || newMaterial->type > RT4_MATERIAL_TURBULENCE)
+        return RT4_INVALID;
+    material currentMat;
+    switch (newMaterial->type)
+    {
+    case RT4_MATERIAL_NOISE:
+        currentMat.type = material::noise;
+        break;
+    case RT4_MATERIAL_MARBLE:
+        currentMat.type = material::marble;
+        break;
+    case RT4_MATERIAL_TURBULENCE:
+        currentMat.type = material::turbulence;
+        break;
+    default:
+        currentMat.type = material::gouraud;
+    }
+    currentMat.diffuse = toColor(newMaterial->diffuse);
+    currentMat.diffuse2 = toColor(newMaterial->diffuse2);
+    currentMat.bump = newMaterial->bump;
+    currentMat.reflection = newMaterial->reflection;
+    currentMat.refraction = newMaterial->refraction;
+    currentMat.density = newMaterial->density;
+    currentMat.specular = toColor(newMaterial->specular);
+    currentMat.power = newMaterial->power;
+    scene->myScene.materialContainer.push_back(currentMat);
+    return int(scene->myScene.materialContainer.size()) - 1;
+}
+
+int rt4_scene_add_sphere(rt4_scene *scene, const float center[3], float size, int material)
+{
+    if (!scene || !center || material < 0 || material >= int(scene->myScene.materialContainer.size()))
+        return RT4_INVALID;
+    sphere currentSphere;
+    currentSphere.pos = toPoint(center);
+    currentSphere.size = size;
+    currentSphere.materialId = material;
+    scene->myScene.sphereContainer.push_back(currentSphere);
+    return int(scene->myScene.sphereContainer.size()) - 1;
+}
+
+int rt4_scene_add_blob(rt4_scene *scene, const float *centers, int centerCount, float size, int material)
+{
+    if (!scene || !centers || centerCount <= 0 || size <= 0.0f ||
+        material < 0 || material >= int(scene->myScene.materialContainer.size()))
+        return RT4_INVALID;
+    blob currentBlob;
+    for (int i = 0; i < centerCount; ++i)
+        currentBlob.centerList.push_back(toPoint(centers + 3 * i));
+    currentBlob.size = size;
+    currentBlob.invSizeSquare = 1.0f / (size * size);
+    currentBlob.materialId = material;
+    scene->myScene.blobContainer.push_back(currentBlob);
+    initBlobZones();
+    return int(scene->myScene.blobContainer.size()) - 1;
+}
+
+int rt4_scene_add_light(rt4_scene *scene, const float position[3], const float intensity[3])
+{
+    if (!scene || !position || !intensity)
+        return RT4_INVALID;
+    light currentLight;
+    currentLight.pos = toPoint(position);
+    currentLight.intensity = toColor(intensity);
+    scene->myScene.lightContainer.push_back(currentLight);
+    return int(scene->myScene.lightContainer.size()) - 1;
+}
+
+int rt4_scene_set_perspective(rt4_scene *scene, float fov, float clearPoint, float dispersion)
+{
+    // Same range as the scene files
+    if (!scene || fov <= 0.0f || fov >= 189.0f)
+        return RT4_INVALID;
+    perspective &persp = scene->myScene.persp;
+    persp.type = perspective::conic;
+    persp.FOV = fov;
+    persp.clearPoint = clearPoint;
+    persp.dispersion = dispersion;
+    persp.invProjectionDistance = 1.0f / (0.5f * scene->myScene.sizex / tanf(float(PIOVER180) * 0.5f * fov));
+    return RT4_OK;
+}
+
+int rt4_scene_set_complexity(rt4_scene *scene, int complexity)
+{
+    if (!scene || complexity <= 0)
+        return RT4_INVALID;
+    scene->myScene.complexity = complexity;
+    return RT4_OK;
+}
+
+int rt4_scene_set_cubemap(rt4_scene *scene, const char *const faces[6], float exposure, int flags)
+{
+    if (!scene || !faces || scene->myScene.cm.texture)
+        return RT4_INVALID;
+    cubemap &cm = scene->myScene.cm;
+    for (int i = 0; i < 6; ++i)
+    {
+        if (!faces[i])
+            return RT4_INVALID;
+        cm.name[i] = faces[i];
+    }
+    cm.exposure = exposure;
+    cm.bsRGB = (flags & RT4_CUBEMAP_SRGB) != 0;
+    cm.bExposed = (flags & RT4_CUBEMAP_EXPOSED) != 0;
+    if (!cm.Init())
+    {
+        cout << "No skybox file found" << endl;
+        return RT4_FAILED;
+    }
+    return RT4_OK;
+}
+
+// Forwards the rows to the callback of the caller
+struct rowForwarder
+{
+    rt4_row_callback rowDone;
+    void *user;
+    int width;
+    atomic<bool> bCancelled;
+};
+
+static bool forwardRow(void *user, int y)
+{
+    rowForwarder &forwarder = *static_cast<rowForwarder *>(user);
+    if (forwarder.rowDone(forwarder.user, y, forwarder.width) != 0)
+    {
+        forwarder.bCancelled = true;
+        return false;
+    }
+    return true;
+}
+
+int rt4_render(rt4_scene *scene, const rt4_render_options *options)
+{
+    if (!scene || !options || !options->pixels || options->threads < 0 || options->width < 0 ||
+        options->height < 0 || options->format < RT4_FORMAT_RGB8 || options->format > RT4_FORMAT_RGB_FLOAT ||
+        options->timeBudget < 0.0f)
+        return RT4_INVALID;
+    renderOptions render;
+    render.threads = options->threads;
+    render.width = options->width;
+    render.height = options->height;
+    render.timeBudget = options->timeBudget;
+    // Left as it is without a time budget
+    budgetReport report;
+    report.fSamples = 4.0f * scene->myScene.complexity;
+    render.budget = &report;
+    int width = renderWidth(scene->myScene, render);
+    int height = renderHeight(scene->myScene, render);
+    if (width <= 0 || height <= 0)
+        return RT4_INVALID;
+
+    renderTarget target;
+    if (options->format == RT4_FORMAT_RGB_FLOAT)
+        target.linear = static_cast<float *>(options->pixels);
+    else
+        target.pixels = static_cast<unsigned char *>(options->pixels);
+    rowForwarder forwarder;
+    forwarder.rowDone = options->rowDone;
+    forwarder.user = options->user;
+    forwarder.width = width;
+    forwarder.bCancelled = false;
+    if (options->rowDone)
+    {
+        target.rowDone = forwardRow;
+        target.user = &forwarder;
+    }
+    if (!renderImage(scene->myScene, render, target))
+        return forwarder.bCancelled ? RT4_CANCELLED : RT4_FAILED;
+    if (options->samplesPerPixel)
+        *options->samplesPerPixel = report.fSamples;
+
+    if (options->format == RT4_FORMAT_RGB8)
+    {
+        // The tonemapping writes the pixels in the order of the TGA files
+        unsigned char *pixel = target.pixels;
+        for (size_t i = size_t(width) * height; i > 0; --i, pixel += 3)
+            swap(pixel[0], pixel[2]);
+    }
+    return RT4_OK;
+}
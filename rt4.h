@@ -0,0 +1,136 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+#ifndef __RT4_H
+#define __RT4_H
+
+// C interface of the renderer, built as librt4.a and librt4.so.
+//
+// Every function can be called from any thread. Different scenes are
+// independent, and a scene can be rendered by several threads at once as
+// long as nobody changes it (rt4_scene_add_*, rt4_scene_set_*,
+// rt4_scene_animate, rt4_scene_free) at the same time.
+// Errors are explained on the standard output, like in rt4 itself.
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#define RT4_API
+#else
+#define RT4_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    RT4_OK = 0,
+    // A parameter is wrong, nothing was done
+    RT4_INVALID = -1,
+    // The tile callback asked to stop
+    RT4_CANCELLED = -2,
+    // The render didn't finish, an output file couldn't be written
+    RT4_FAILED = -3
+};
+
+typedef struct rt4_scene rt4_scene;
+
+// Scene file, text or compiled with rt4 --compile. NULL when it can't be read.
+RT4_API rt4_scene *rt4_scene_load(const char *fileName);
+// Text of a scene file held in memory, it doesn't have to be zero terminated
+RT4_API rt4_scene *rt4_scene_parse(const char *text, size_t size);
+// Empty scene to fill with the functions below. The camera is orthogonal,
+// there is no cubemap and the tonemapping has the defaults of the scene files.
+RT4_API rt4_scene *rt4_scene_create(int width, int height);
+RT4_API void rt4_scene_free(rt4_scene *scene);
+
+RT4_API void rt4_scene_size(const rt4_scene *scene, int *width, int *height);
+// Moves the animated objects to that frame, nothing happens for a still scene
+RT4_API void rt4_scene_animate(rt4_scene *scene, int frame);
+
+enum {
+    RT4_MATERIAL_GOURAUD = 0,
+    RT4_MATERIAL_NOISE = 1,
+    RT4_MATERIAL_MARBLE = 2,
+    RT4_MATERIAL_TURBULENCE = 3
+};
+
+// Same values as the Material sections of the scene files, colors are RGB
+typedef struct rt4_material {
+    int type;
+    float diffuse[3];
+    // Second diffuse color of the procedural materials
+    float diffuse2[3];
+    float bump, reflection, refraction, density;
+    float specular[3];
+    float power;
+} rt4_material;
+
+// The functions adding something return its index, or RT4_INVALID.
+// Materials have to be added before the objects using them.
+RT4_API int rt4_scene_add_material(rt4_scene *scene, const rt4_material *material);
+RT4_API int rt4_scene_add_sphere(rt4_scene *scene, const float center[3], float size, int material);
+// centers holds 3 floats for each center
+RT4_API int rt4_scene_add_blob(rt4_scene *scene, const float *centers, int centerCount, float size, int material);
+RT4_API int rt4_scene_add_light(rt4_scene *scene, const float position[3], const float intensity[3]);
+
+// Conic perspective, see the Perspective keys of the scene files
+RT4_API int rt4_scene_set_perspective(rt4_scene *scene, float fov, float clearPoint, float dispersion);
+// Number of rays per fragment
+RT4_API int rt4_scene_set_complexity(rt4_scene *scene, int complexity);
+
+enum {
+    RT4_CUBEMAP_SRGB = 1,
+    RT4_CUBEMAP_EXPOSED = 2
+};
+
+// Loads the six TGA faces (up, down, right, left, forward, backward),
+// once per scene
+RT4_API int rt4_scene_set_cubemap(rt4_scene *scene, const char *const faces[6], float exposure, int flags);
+
+enum {
+    // Tonemapped sRGB pixels, 3 bytes each
+    RT4_FORMAT_RGB8 = 0,
+    RT4_FORMAT_BGR8 = 1,
+    // Linear pixels before the exposure, 3 floats each
+    RT4_FORMAT_RGB_FLOAT = 2
+};
+
+// Called by the rendering threads once a row of the image is traced.
+// The pixels of the row are in the buffer already for RT4_FORMAT_RGB_FLOAT.
+// The other formats need the whole image for the exposure, their pixels
+// are written when all the rows are traced.
+// Returning non zero stops the render.
+typedef int (*rt4_row_callback)(void *user, int y, int width);
+
+// Zero is the default of every field
+typedef struct rt4_render_options {
+    // 0 for one rendering thread per hardware thread
+    int threads;
+    // 0 for the size of the scene
+    int width, height;
+    int format;
+    // width * height pixels, the rows in the order of the TGA files
+    void *pixels;
+    rt4_row_callback rowDone;
+    void *user;
+    // Seconds the render may take, 0 for no limit. The quality is lowered to fit,
+    // the rows are traced and reported once per pass.
+    float timeBudget;
+    // Rays per pixel reached within the time budget, can be NULL
+    float *samplesPerPixel;
+} rt4_render_options;
+
+RT4_API int rt4_render(rt4_scene *scene, const rt4_render_options *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RT4_H
@@ -0,0 +1,177 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+/* Example of a program rendering in process through librt4 (rt4.h).
+   It reads a scene file in memory, renders it from two threads at once,
+   in BGR and RGB bytes, checks that both agree and writes the first one.
+   Then it builds a small scene without any file and renders it too. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "rt4.h"
+
+struct renderCall {
+    rt4_scene *scene;
+    rt4_render_options options;
+    int rows;
+    int result;
+};
+
+static int countRow(void *user, int y, int width)
+{
+    (void)y;
+    (void)width;
+    /* Rows come from all the rendering threads */
+    __atomic_add_fetch(&((struct renderCall *)user)->rows, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+static void *renderThread(void *user)
+{
+    struct renderCall *call = (struct renderCall *)user;
+    call->result = rt4_render(call->scene, &call->options);
+    return NULL;
+}
+
+static int writeTga(const char *name, const unsigned char *bgr, int width, int height)
+{
+    unsigned char header[18] = {0};
+    FILE *file = fopen(name, "wb");
+    if (!file)
+        return 0;
+    header[2] = 2;
+    header[12] = (unsigned char)(width & 0xFF);
+    header[13] = (unsigned char)(width >> 8);
+    header[14] = (unsigned char)(height & 0xFF);
+    header[15] = (unsigned char)(height >> 8);
+    header[16] = 24;
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(bgr, 3, (size_t)width * height, file);
+    return fclose(file) == 0;
+}
+
+static char *readFile(const char *name, size_t *size)
+{
+    char *text;
+    FILE *file = fopen(name, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    *size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text = (char *)malloc(*size + 1);
+    if (text && fread(text, 1, *size, file) != *size)
+    {
+        free(text);
+        text = NULL;
+    }
+    fclose(file);
+    return text;
+}
+
+static int renderFileScene(const char *sceneName, const char *outputName, int threads)
+{
+    struct renderCall calls[2];
+    pthread_t handles[2];
+    size_t size, pixelCount, i;
+    int width, height, bSame = 1, n;
+    char *text = readFile(sceneName, &size);
+    rt4_scene *scene;
+    if (!text)
+    {
+        printf("Failure when reading %s.\n", sceneName);
+        return 0;
+    }
+    scene = rt4_scene_parse(text, size);
+    free(text);
+    if (!scene)
+        return 0;
+    rt4_scene_size(scene, &width, &height);
+    pixelCount = (size_t)width * height;
+
+    memset(calls, 0, sizeof(calls));
+    for (n = 0; n < 2; ++n)
+    {
+        calls[n].scene = scene;
+        calls[n].options.threads = threads;
+        calls[n].options.format = n == 0 ? RT4_FORMAT_BGR8 : RT4_FORMAT_RGB8;
+        calls[n].options.pixels = malloc(3 * pixelCount);
+        calls[n].options.rowDone = countRow;
+        calls[n].options.user = &calls[n];
+        pthread_create(&handles[n], NULL, renderThread, &calls[n]);
+    }
+    for (n = 0; n < 2; ++n)
+        pthread_join(handles[n], NULL);
+
+    if (calls[0].result == RT4_OK && calls[1].result == RT4_OK)
+    {
+        const unsigned char *bgr = (const unsigned char *)calls[0].options.pixels;
+        const unsigned char *rgb = (const unsigned char *)calls[1].options.pixels;
+        for (i = 0; i < pixelCount && bSame; ++i)
+            bSame = bgr[3 * i] == rgb[3 * i + 2] && bgr[3 * i + 1] == rgb[3 * i + 1] && bgr[3 * i + 2] == rgb[3 * i];
+        printf("%s : %dx%d, %d and %d rows, %s\n", sceneName, width, height, calls[0].rows, calls[1].rows,
+               bSame ? "same pixels" : "different pixels");
+        bSame = bSame && writeTga(outputName, bgr, width, height);
+    }
+    else
+    {
+        printf("Failure when rendering %s.\n", sceneName);
+        bSame = 0;
+    }
+    free(calls[0].options.pixels);
+    free(calls[1].options.pixels);
+    rt4_scene_free(scene);
+    return bSame;
+}
+
+static int renderBuiltScene(const char *outputName, int threads)
+{
+    static const rt4_material red = {RT4_MATERIAL_GOURAUD, {1.0f, 0.2f, 0.2f}, {0, 0, 0}, 0, 0, 0, 0, {1, 1, 1}, 60};
+    static const rt4_material marble = {RT4_MATERIAL_MARBLE, {0.9f, 0.9f, 0.8f}, {0.2f, 0.2f, 0.4f}, 0, 0, 0, 1.0f, {0, 0, 0}, 0};
+    static const float center0[3] = {220.0f, 240.0f, 400.0f}, center1[3] = {420.0f, 240.0f, 450.0f};
+    static const float lightPosition[3] = {0.0f, 240.0f, -100.0f}, lightIntensity[3] = {2.0f, 2.0f, 2.0f};
+    static const float blobCenters[6] = {320.0f, 380.0f, 350.0f, 360.0f, 400.0f, 330.0f};
+    const int width = 640, height = 480;
+    rt4_render_options options;
+    int bSuccess;
+    rt4_scene *scene = rt4_scene_create(width, height);
+    int redId = rt4_scene_add_material(scene, &red);
+    int marbleId = rt4_scene_add_material(scene, &marble);
+    rt4_scene_add_sphere(scene, center0, 100.0f, redId);
+    rt4_scene_add_sphere(scene, center1, 80.0f, marbleId);
+    rt4_scene_add_blob(scene, blobCenters, 2, 60.0f, redId);
+    rt4_scene_add_light(scene, lightPosition, lightIntensity);
+    rt4_scene_set_perspective(scene, 45.0f, 400.0f, 0.0f);
+
+    memset(&options, 0, sizeof(options));
+    options.threads = threads;
+    options.format = RT4_FORMAT_BGR8;
+    options.pixels = malloc(3 * (size_t)width * height);
+    bSuccess = rt4_render(scene, &options) == RT4_OK && writeTga(outputName, (const unsigned char *)options.pixels, width, height);
+    printf("scene built in memory : %s\n", bSuccess ? "rendered" : "failed");
+    free(options.pixels);
+    rt4_scene_free(scene);
+    return bSuccess;
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    if (argc == 6 && strcmp(argv[4], "--threads") == 0)
+        threads = atoi(argv[5]);
+    else if (argc != 4)
+    {
+        printf("Usage : rt4-embed scene.txt scene.tga built.tga [--threads N]\n");
+        return -1;
+    }
+    if (!renderFileScene(argv[1], argv[2], threads) || !renderBuiltScene(argv[3], threads))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// Offline tonemapping.
+// rt4 --hdr writes the image before tonemapping, this tool runs the exact
+// tonemapping of rt4 on that file. The Tonemap settings can be changed
+// without rendering again : with the same settings the TGA file is the
+// same as the one rt4 wrote.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+using namespace std;
+
+#include "Tonemap.h"
+#include "HdrFile.h"
+#include "Config.h"
+
+static void usage()
+{
+    cout << "Usage : rt4-tonemap [options] Image.exr Output.tga" << endl
+         << "  Image.exr or Image.pfm is written by rt4 --hdr" << endl
+         << "  --scene Scene.txt    take the Tonemap settings of the scene" << endl
+         << "  --midpoint M         Tonemap.Midpoint (0.6)" << endl
+         << "  --power P            Tonemap.Power (3)" << endl
+         << "  --black B            Tonemap.Black (0.1)" << endl
+         << "  --exposure E         Tonemap.Exposure, rms or logaverage (rms)" << endl
+         << "  --outliers F         Tonemap.Outliers (0)" << endl
+         << "  --dither, --no-dither  Tonemap.Dither (no)" << endl
+         << "  --threads N          number of threads (default one per cpu)" << endl
+         << "  --stats              print the exposure and the time taken" << endl
+         << "  The options override the scene file, in the order they are given." << endl;
+}
+
+static bool writeTga(const char *fileName, const vector<unsigned char> &pixels, int width, int height)
+{
+    ofstream imageFile(fileName, ios_base::binary);
+    if (!imageFile)
+        return false;
+    // Same header as the images of rt4
+    unsigned char header[18] = {0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                (unsigned char)(width & 0xFF), (unsigned char)(width >> 8),
+                                (unsigned char)(height & 0xFF), (unsigned char)(height >> 8), 24, 0};
+    imageFile.write((const char *)header, sizeof(header));
+    imageFile.write((const char *)&pixels[0], pixels.size());
+    return bool(imageFile);
+}
+
+int main(int argc, char* argv[])
+{
+    // Same defaults as the scene files
+    tonemapSettings tonemap = {tonemapSettings::rms, 0.0f, 0.6f, 3.0f, 0.1f, 0.0f, false, 0.75f};
+    int nbThreads = 0;
+    bool bStats = false;
+    const char *files[2];
+    int nbFiles = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *option = argv[i];
+        bool bHasValue = (i + 1 < argc);
+        if (strcmp(option, "--scene") == 0 && bHasValue)
+        {
+            Config sceneFile(argv[++i]);
+            if (sceneFile.SetSection("Scene") == -1)
+            {
+                cout << "Mal formed Scene file : No Scene section." << endl;
+                return -1;
+            }
+            if (!readTonemapSettings(sceneFile, tonemap))
+                return -1;
+        }
+        else if (strcmp(option, "--midpoint") == 0 && bHasValue)
+            tonemap.fMidPoint = float(atof(argv[++i]));
+        else if (strcmp(option, "--power") == 0 && bHasValue)
+            tonemap.fPower = float(atof(argv[++i]));
+        else if (strcmp(option, "--black") == 0 && bHasValue)
+            tonemap.fBlack = float(atof(argv[++i]));
+        else if (strcmp(option, "--outliers") == 0 && bHasValue)
+            tonemap.fOutliers = float(atof(argv[++i]));
+        else if (strcmp(option, "--exposure") == 0 && bHasValue)
+        {
+            const char *exposureType = argv[++i];
+            if (strcmp(exposureType, "rms") == 0)
+                tonemap.exposureType = tonemapSettings::rms;
+            else if (strcmp(exposureType, "logaverage") == 0)
+                tonemap.exposureType = tonemapSettings::logAverage;
+            else
+            {
+                usage();
+                return -1;
+            }
+        }
+        else if (strcmp(option, "--dither") == 0)
+            tonemap.bDither = true;
+        else if (strcmp(option, "--no-dither") == 0)
+            tonemap.bDither = false;
+        else if (strcmp(option, "--threads") == 0 && bHasValue)
+            nbThreads = atoi(argv[++i]);
+        else if (strcmp(option, "--stats") == 0)
+            bStats = true;
+        else if (option[0] != '-' && nbFiles < 2)
+            files[nbFiles++] = option;
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+    if (nbFiles < 2)
+    {
+        usage();
+        return -1;
+    }
+    if (!setupTonemap(tonemap))
+        return -1;
+
+    hdrImage image;
+    vector<color> fragments;
+    if (!readHdrImage(files[0], image, fragments))
+    {
+        cout << "Failure when reading the HDR file." << endl;
+        return -1;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    float exposure = computeExposure(image, tonemap, nbThreads);
+    vector<unsigned char> pixels(3 * size_t(image.width) * image.height);
+    tonemapImage(image, tonemap, exposure, &pixels[0], nbThreads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (bStats)
+    {
+        cout << "Tonemapped " << image.width << "x" << image.height << " with exposure " 
+             << exposure << " in " << seconds * 1000.0 << " ms, curve table error " 
+             << tonemapTableError(tonemap) << endl;
+    }
+
+    if (!writeTga(files[1], pixels, image.width, image.height))
+    {
+        cout << "Failure when writing the image file." << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,671 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// Render daemon.
+// It keeps the scenes and their cubemaps loaded between renders, so that
+// small renders don't pay for the start of a process and the loading of
+// the cubemap every time. Jobs come from a Unix domain socket and are
+// rendered one after the other, the highest priority first, each one with
+// all the rendering threads.
+//
+// The protocol is a line of text per command and a line per reply :
+//   submit output=out.tga scene=scene.txt [width=W] [height=H] [threads=N]
+//          [frame=F] [hdr=out.exr] [priority=P]
+//   submit output=out.tga inline=SIZE [...]   followed by SIZE bytes of scene text
+//                 -> ok ID
+//   status ID     -> queued | running ROWS/HEIGHT | done SECONDS | failed | cancelled
+//   wait ID       -> the status, once the job is finished
+//   cancel ID     -> ok
+//   list          -> ID:STATE ID:STATE ...
+//   shutdown      -> ok, the jobs already queued are still rendered
+// Anything wrong gets "error" and a message. Names can't contain spaces.
+// The last finished jobs are kept for status, wait and list, the older ones
+// are forgotten and get "error no such job". An inline scene larger than
+// maxInlineSceneSize gets an error and the connection is closed.
+//
+// rt4d --send "command" [--inline scene.txt] is a small client that
+// prints the reply.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+using namespace std;
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "Raytrace.h"
+#include "Scene.h"
+#include "MappedFile.h"
+
+static const char *defaultSocket = "/tmp/rt4d.sock";
+// Loaded scenes kept around, the least recently used one goes first
+const size_t maxCachedScenes = 8;
+// Finished jobs kept around, done, failed or cancelled, the oldest one goes first
+const size_t maxFinishedJobs = 64;
+// Largest scene text sent with a job, the connection is closed beyond it
+const long maxInlineSceneSize = 64L * 1024 * 1024;
+
+struct renderRequest
+{
+    int id;
+    int priority;
+    SimpleString sceneName;
+    // Scenes sent with the job, empty when it comes from a file
+    vector<char> sceneText;
+    SimpleString outputName, hdrName;
+    int width, height, threads, frame;
+    enum {
+        queued,
+        running,
+        done,
+        failed,
+        cancelled
+    } state;
+    atomic<int> rowsDone;
+    int rows;
+    atomic<bool> bCancel;
+    double seconds;
+    // Connections waiting for the job to finish, it is kept until they have its status
+    int waiters;
+};
+
+// Everything the connections and the render thread share
+struct daemonState
+{
+    mutex lock;
+    // Signaled when a job is added and when one is finished
+    condition_variable changed;
+    vector<renderRequest *> jobs;
+    int nextId;
+    bool bShutdown;
+    int listenSocket;
+};
+
+struct cachedScene
+{
+    // Name of the file, or hash of the inline text
+    SimpleString key;
+    // Modification time and size, a file that changed is loaded again
+    long long stamp;
+    unsigned long long lastUse;
+    scene *myScene;
+};
+
+static bool fileStamp(const char *name, long long &stamp)
+{
+    struct stat fileStat;
+    if (stat(name, &fileStat) != 0)
+        return false;
+    stamp = (long long)fileStat.st_mtim.tv_sec * 1000000000LL + fileStat.st_mtim.tv_nsec + fileStat.st_size;
+    return true;
+}
+
+// Returns the loaded scene of the job, loading it if needed
+static scene *findScene(vector<cachedScene> &cache, const renderRequest &job, unsigned long long useCount)
+{
+    SimpleString key;
+    long long stamp = 0;
+    if (job.sceneText.empty())
+    {
+        key.append("file:");
+        key.append(job.sceneName.c_str());
+        if (!fileStamp(job.sceneName.c_str(), stamp))
+            return NULL;
+    }
+    else
+    {
+        char hash[32];
+        snprintf(hash, sizeof(hash), "inline:%016llx", hashBytes(&job.sceneText[0], job.sceneText.size()));
+        key.append(hash);
+    }
+    for (size_t i = 0; i < cache.size(); ++i)
+    {
+        if (cache[i].key.compare(key) != 0)
+            continue;
+        if (cache[i].stamp == stamp)
+        {
+            cache[i].lastUse = useCount;
+            return cache[i].myScene;
+        }
+        delete cache[i].myScene;
+        cache.erase(cache.begin() + i);
+        break;
+    }
+
+    scene *myScene = new scene;
+    bool bLoaded;
+    if (job.sceneText.empty())
+    {
+        vector<char> name(job.sceneName.c_str(), job.sceneName.c_str() + job.sceneName.size() + 1);
+        bLoaded = init(&name[0], *myScene);
+    }
+    else
+    {
+        bLoaded = initInline(&job.sceneText[0], job.sceneText.size(), *myScene);
+    }
+    if (!bLoaded)
+    {
+        delete myScene;
+        return NULL;
+    }
+    if (cache.size() >= maxCachedScenes)
+    {
+        size_t oldest = 0;
+        for (size_t i = 1; i < cache.size(); ++i)
+        {
+            if (cache[i].lastUse < cache[oldest].lastUse)
+                oldest = i;
+        }
+        delete cache[oldest].myScene;
+        cache.erase(cache.begin() + oldest);
+    }
+    cachedScene entry = {key, stamp, useCount, myScene};
+    cache.push_back(entry);
+    return myScene;
+}
+
+static bool isFinished(const renderRequest &job)
+{
+    return job.state != renderRequest::queued && job.state != renderRequest::running;
+}
+
+// Deletes the oldest finished jobs beyond maxFinishedJobs, called with the lock held
+static void retireJobs(daemonState &state)
+{
+    size_t finished = 0;
+    for (size_t i = 0; i < state.jobs.size(); ++i)
+    {
+        if (isFinished(*state.jobs[i]))
+            ++finished;
+    }
+    for (size_t i = 0; i < state.jobs.size() && finished > maxFinishedJobs; )
+    {
+        renderRequest *job = state.jobs[i];
+        if (isFinished(*job) && job->waiters == 0)
+        {
+            state.jobs.erase(state.jobs.begin() + i);
+            delete job;
+            --finished;
+        }
+        else
+            ++i;
+    }
+}
+
+static void renderLoop(daemonState *state)
+{
+    vector<cachedScene> cache;
+    unsigned long long useCount = 0;
+    for (;;)
+    {
+        renderRequest *job = NULL;
+        {
+            unique_lock<mutex> guard(state->lock);
+            for (;;)
+            {
+                // Highest priority first, then in the order they came
+                for (size_t i = 0; i < state->jobs.size(); ++i)
+                {
+                    renderRequest *current = state->jobs[i];
+                    if (current->state == renderRequest::queued && (!job || current->priority > job->priority))
+                        job = current;
+                }
+                if (job || state->bShutdown)
+                    break;
+                state->changed.wait(guard);
+            }
+            if (!job)
+                break;
+            job->state = renderRequest::running;
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool bSuccess = false;
+        scene *myScene = findScene(cache, *job, ++useCount);
+        if (myScene)
+        {
+            animateScene(*myScene, job->frame);
+            renderOptions options;
+            options.threads = job->threads;
+            options.width = job->width;
+            options.height = job->height;
+            options.hdrName = job->hdrName.empty() ? NULL : job->hdrName.c_str();
+            options.progress = &job->rowsDone;
+            options.cancel = &job->bCancel;
+            {
+                lock_guard<mutex> guard(state->lock);
+                job->rows = job->height > 0 ? job->height : myScene->sizey;
+            }
+            vector<char> outputName(job->outputName.c_str(), job->outputName.c_str() + job->outputName.size() + 1);
+            bSuccess = draw(&outputName[0], *myScene, options);
+            if (!bSuccess && job->bCancel)
+                remove(job->outputName.c_str());
+        }
+
+        lock_guard<mutex> guard(state->lock);
+        job->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        job->state = bSuccess ? renderRequest::done : job->bCancel ? renderRequest::cancelled : renderRequest::failed;
+        // The scene stays in the cache, the text isn't needed anymore
+        vector<char>().swap(job->sceneText);
+        retireJobs(*state);
+        state->changed.notify_all();
+    }
+    for (size_t i = 0; i < cache.size(); ++i)
+        delete cache[i].myScene;
+}
+
+static renderRequest *findJob(daemonState &state, int id)
+{
+    for (size_t i = 0; i < state.jobs.size(); ++i)
+    {
+        if (state.jobs[i]->id == id)
+            return state.jobs[i];
+    }
+    return NULL;
+}
+
+// Called with the lock held
+static SimpleString jobStatus(const renderRequest &job)
+{
+    char status[64];
+    switch (job.state)
+    {
+    case renderRequest::queued:
+        return SimpleString("queued");
+    case renderRequest::running:
+        snprintf(status, sizeof(status), "running %d/%d", int(job.rowsDone), job.rows);
+        return SimpleString(status);
+    case renderRequest::done:
+        snprintf(status, sizeof(status), "done %.3f", job.seconds);
+        return SimpleString(status);
+    case renderRequest::failed:
+        return SimpleString("failed");
+    default:
+        return SimpleString("cancelled");
+    }
+}
+
+// Reads the connection one line at a time, the bytes after the line stay in the buffer
+struct lineReader
+{
+    int fd;
+    vector<char> buffer;
+
+    bool fill()
+    {
+        char chunk[4096];
+        ssize_t count = read(fd, chunk, sizeof(chunk));
+        if (count <= 0)
+            return false;
+        buffer.insert(buffer.end(), chunk, chunk + count);
+        return true;
+    }
+    bool readLine(SimpleString &line)
+    {
+        for (;;)
+        {
+            vector<char>::iterator end = find(buffer.begin(), buffer.end(), '\n');
+            if (end != buffer.end())
+            {
+                line = SimpleString(&buffer[0], int(end - buffer.begin()));
+                buffer.erase(buffer.begin(), end + 1);
+                return true;
+            }
+            if (!fill())
+                return false;
+        }
+    }
+    bool readBytes(vector<char> &bytes, size_t count)
+    {
+        while (buffer.size() < count)
+        {
+            if (!fill())
+                return false;
+        }
+        bytes.assign(buffer.begin(), buffer.begin() + count);
+        buffer.erase(buffer.begin(), buffer.begin() + count);
+        return true;
+    }
+};
+
+static bool reply(int fd, const SimpleString &message)
+{
+    SimpleString line(message);
+    line.append("\n");
+    const char *data = line.c_str();
+    size_t left = size_t(line.size());
+    while (left > 0)
+    {
+        ssize_t count = write(fd, data, left);
+        if (count <= 0)
+            return false;
+        data += count;
+        left -= size_t(count);
+    }
+    return true;
+}
+
+// Splits a command in words
+static vector<SimpleString> splitWords(const SimpleString &line)
+{
+    vector<SimpleString> words;
+    const char *current = line.c_str();
+    while (*current)
+    {
+        while (*current == ' ' || *current == '\t' || *current == '\r')
+            ++current;
+        const char *start = current;
+        while (*current && *current != ' ' && *current != '\t' && *current != '\r')
+            ++current;
+        if (current != start)
+            words.push_back(SimpleString(start, int(current - start)));
+    }
+    return words;
+}
+
+// bClose is set when the rest of the connection can't be read anymore
+static SimpleString submitJob(daemonState &state, const vector<SimpleString> &words, lineReader &reader, bool &bClose)
+{
+    renderRequest *job = new renderRequest;
+    job->priority = 0;
+    job->width = job->height = job->threads = job->frame = 0;
+    job->state = renderRequest::queued;
+    job->rowsDone = 0;
+    job->rows = 0;
+    job->bCancel = false;
+    job->seconds = 0.0;
+    job->waiters = 0;
+    long inlineSize = -1;
+    bool bValid = true;
+    for (size_t i = 1; i < words.size(); ++i)
+    {
+        const char *word = words[i].c_str();
+        const char *value = strchr(word, '=');
+        if (!value)
+        {
+            bValid = false;
+            continue;
+        }
+        SimpleString name(word, int(value - word));
+        ++value;
+        if (name.compare("scene") == 0)
+            job->sceneName = value;
+        else if (name.compare("inline") == 0)
+            inlineSize = atol(value);
+        else if (name.compare("output") == 0)
+            job->outputName = value;
+        else if (name.compare("hdr") == 0)
+            job->hdrName = value;
+        else if (name.compare("width") == 0)
+            job->width = atoi(value);
+        else if (name.compare("height") == 0)
+            job->height = atoi(value);
+        else if (name.compare("threads") == 0)
+            job->threads = atoi(value);
+        else if (name.compare("frame") == 0)
+            job->frame = atoi(value);
+        else if (name.compare("priority") == 0)
+            job->priority = atoi(value);
+        else
+            bValid = false;
+    }
+    // The text of a scene that big isn't read, what follows it can't be understood
+    if (inlineSize > maxInlineSceneSize)
+    {
+        delete job;
+        bClose = true;
+        return SimpleString("error inline scene too big");
+    }
+    // The scene text follows the command, it has to be read even if the command is wrong
+    if (inlineSize > 0 && !reader.readBytes(job->sceneText, size_t(inlineSize)))
+        bValid = false;
+    if (!bValid || job->outputName.empty() || job->sceneName.empty() == job->sceneText.empty()
+        || job->width < 0 || job->height < 0)
+    {
+        delete job;
+        return SimpleString("error wrong submit command");
+    }
+
+    lock_guard<mutex> guard(state.lock);
+    if (state.bShutdown)
+    {
+        delete job;
+        return SimpleString("error shutting down");
+    }
+    job->id = state.nextId++;
+    state.jobs.push_back(job);
+    state.changed.notify_all();
+    char answer[32];
+    snprintf(answer, sizeof(answer), "ok %d", job->id);
+    return SimpleString(answer);
+}
+
+static void serveConnection(daemonState *state, int fd)
+{
+    lineReader reader;
+    reader.fd = fd;
+    SimpleString line;
+    while (reader.readLine(line))
+    {
+        vector<SimpleString> words = splitWords(line);
+        if (words.empty())
+            continue;
+        const SimpleString &command = words[0];
+        SimpleString answer("error unknown command");
+        bool bClose = false;
+        if (command.compare("submit") == 0)
+        {
+            answer = submitJob(*state, words, reader, bClose);
+        }
+        else if (command.compare("list") == 0)
+        {
+            lock_guard<mutex> guard(state->lock);
+            answer = SimpleString("");
+            for (size_t i = 0; i < state->jobs.size(); ++i)
+            {
+                char item[64];
+                SimpleString status = jobStatus(*state->jobs[i]);
+                snprintf(item, sizeof(item), "%s%d:%s", i ? " " : "", state->jobs[i]->id, splitWords(status)[0].c_str());
+                answer.append(item);
+            }
+        }
+        else if (command.compare("shutdown") == 0)
+        {
+            lock_guard<mutex> guard(state->lock);
+            state->bShutdown = true;
+            state->changed.notify_all();
+            // The reply goes first, the daemon may be gone once the accept loop wakes up
+            reply(fd, SimpleString("ok"));
+            shutdown(state->listenSocket, SHUT_RDWR);
+            break;
+        }
+        else if (words.size() == 2 && (command.compare("status") == 0 || command.compare("wait") == 0
+                                       || command.compare("cancel") == 0))
+        {
+            unique_lock<mutex> guard(state->lock);
+            renderRequest *job = findJob(*state, atoi(words[1].c_str()));
+            if (!job)
+                answer = SimpleString("error no such job");
+            else if (command.compare("cancel") == 0)
+            {
+                job->bCancel = true;
+                if (job->state == renderRequest::queued)
+                {
+                    job->state = renderRequest::cancelled;
+                    vector<char>().swap(job->sceneText);
+                    retireJobs(*state);
+                }
+                state->changed.notify_all();
+                answer = SimpleString("ok");
+            }
+            else
+            {
+                ++job->waiters;
+                while (command.compare("wait") == 0 && !isFinished(*job))
+                    state->changed.wait(guard);
+                --job->waiters;
+                answer = jobStatus(*job);
+                retireJobs(*state);
+            }
+        }
+        if (!reply(fd, answer) || bClose)
+            break;
+    }
+    close(fd);
+}
+
+static bool socketAddress(const char *socketName, sockaddr_un &address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketName) >= sizeof(address.sun_path))
+        return false;
+    strcpy(address.sun_path, socketName);
+    return true;
+}
+
+static int serve(const char *socketName)
+{
+    sockaddr_un address;
+    if (!socketAddress(socketName, address))
+    {
+        cout << "The socket name is too long." << endl;
+        return -1;
+    }
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    // A socket left by a previous daemon would make bind fail
+    unlink(socketName);
+    if (listenSocket < 0 || bind(listenSocket, (sockaddr *)&address, sizeof(address)) != 0
+        || listen(listenSocket, 16) != 0)
+    {
+        cout << "Failure when opening the socket " << socketName << "." << endl;
+        return -1;
+    }
+    // Clients that go away before their reply must not kill the daemon
+    signal(SIGPIPE, SIG_IGN);
+
+    // The connection threads are detached and can still use the state after
+    // the render thread is done, it is never freed
+    daemonState &state = *new daemonState;
+    state.nextId = 1;
+    state.bShutdown = false;
+    state.listenSocket = listenSocket;
+    thread renderer(renderLoop, &state);
+    cout << "rt4d listening on " << socketName << endl;
+    for (;;)
+    {
+        int connection = accept(listenSocket, NULL, NULL);
+        if (connection < 0)
+        {
+            lock_guard<mutex> guard(state.lock);
+            if (state.bShutdown)
+                break;
+            continue;
+        }
+        thread(serveConnection, &state, connection).detach();
+    }
+    renderer.join();
+    close(listenSocket);
+    unlink(socketName);
+    return 0;
+}
+
+static int send(const char *socketName, const char *command, const char *inlineName)
+{
+    sockaddr_un address;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!socketAddress(socketName, address) || fd < 0 || connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        cout << "Failure when connecting to " << socketName << "." << endl;
+        return -1;
+    }
+    SimpleString line(command);
+    mappedFile sceneFile;
+    if (inlineName)
+    {
+        if (!sceneFile.Open(inlineName))
+        {
+            cout << "Failure when reading " << inlineName << "." << endl;
+            return -1;
+        }
+        char size[32];
+        snprintf(size, sizeof(size), " inline=%lu", (unsigned long)sceneFile.size);
+        line.append(size);
+    }
+    bool bSent = reply(fd, line);
+    for (size_t sent = 0; bSent && sent < sceneFile.size; )
+    {
+        ssize_t count = write(fd, sceneFile.data + sent, sceneFile.size - sent);
+        bSent = count > 0;
+        sent += bSent ? size_t(count) : 0;
+    }
+    lineReader reader;
+    reader.fd = fd;
+    SimpleString answer;
+    if (!bSent || !reader.readLine(answer))
+    {
+        cout << "No answer from " << socketName << "." << endl;
+        return -1;
+    }
+    cout << answer.c_str() << endl;
+    close(fd);
+    return strncmp(answer.c_str(), "error", 5) == 0 ? 1 : 0;
+}
+
+static void usage()
+{
+    cout << "Usage : rt4d [--socket name]" << endl
+         << "        rt4d [--socket name] --send \"command\" [--inline scene.txt]" << endl
+         << "  --socket name  Unix domain socket (" << defaultSocket << ")" << endl
+         << "  --send         send a command to the daemon and print the reply," << endl
+         << "                 see tools/rt4d.cpp for the commands" << endl
+         << "  --inline       send that scene with a submit command" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    const char *socketName = defaultSocket;
+    const char *command = NULL;
+    const char *inlineName = NULL;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool bHasValue = (i + 1 < argc);
+        if (strcmp(argv[i], "--socket") == 0 && bHasValue)
+            socketName = argv[++i];
+        else if (strcmp(argv[i], "--send") == 0 && bHasValue)
+            command = argv[++i];
+        else if (strcmp(argv[i], "--inline") == 0 && bHasValue)
+            inlineName = argv[++i];
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+    if (command)
+        return send(socketName, command, inlineName);
+    if (inlineName)
+    {
+        usage();
+        return -1;
+    }
+    return serve(socketName);
+}
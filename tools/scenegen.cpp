@@ -0,0 +1,291 @@
+/*
+    This file belongs to the Ray tracing tutorial of http://www.codermind.com/
+    It is free to use for educational purpose and cannot be redistributed
+    outside of the tutorial pages.
+    Any further inquiry :
+    mailto:info@codermind.com
+ */
+
+// Procedural scene generator.
+// It writes scene files in the same format as scene.txt, with as many objects
+// as we want, so that we can measure how the renderer scales.
+// The output only depends on the parameters : the random generator is our own
+// so the same command line gives the same file on every platform.
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// Materials are generated for each of those families
+enum {
+    familyGouraud = 0,
+    familyTurbulence = 1,
+    familyMarble = 2,
+    familyGlass = 3,
+    familyCount = 4
+};
+
+// Number of materials generated for each family
+const int variantsPerFamily = 4;
+
+struct generatorParameters {
+    int nbSpheres;
+    int nbBlobs;
+    int nbCenters;
+    int nbLights;
+    float mix[familyCount];
+    int width, height;
+    int complexity;
+    float dispersion;
+    unsigned int seed;
+    bool bCubemap;
+};
+
+// Small linear congruential generator, same sequence everywhere
+struct generatorRandom {
+    unsigned int state;
+    explicit generatorRandom(unsigned int seed) : state(seed * 2654435761U + 1U) {};
+    unsigned int next() {
+        state = state * 1664525U + 1013904223U;
+        return state >> 8;
+    };
+    // Uniform in [a, b]
+    float range(float a, float b) {
+        return a + (b - a) * float(next()) / float(1 << 24);
+    };
+};
+
+static int pickMaterial(generatorRandom &random, const generatorParameters &params)
+{
+    float total = 0.0f;
+    for (int i = 0; i < familyCount; ++i)
+        total += params.mix[i];
+    float choice = random.range(0.0f, total);
+    int family = familyCount - 1;
+    for (int i = 0; i < familyCount; ++i)
+    {
+        if (choice < params.mix[i])
+        {
+            family = i;
+            break;
+        }
+        choice -= params.mix[i];
+    }
+    return family * variantsPerFamily + int(random.next() % variantsPerFamily);
+}
+
+static void writeColor(ostream &output, const char *name, float r, float g, float b)
+{
+    output << "  " << name << " = " << r << ", " << g << ", " << b << ";\n";
+}
+
+// The order in which function arguments are evaluated is not defined,
+// so the random numbers are always drawn one statement at a time.
+static void writeRandomColor(ostream &output, const char *name, generatorRandom &random, float a, float b)
+{
+    float red = random.range(a, b);
+    float green = random.range(a, b);
+    float blue = random.range(a, b);
+    writeColor(output, name, red, green, blue);
+}
+
+static void writeRandomPoint(ostream &output, const char *name, generatorRandom &random, 
+                             float xMin, float xMax, float yMin, float yMax, float zMin, float zMax)
+{
+    float x = random.range(xMin, xMax);
+    float y = random.range(yMin, yMax);
+    float z = random.range(zMin, zMax);
+    output << "  " << name << " = " << x << ", " << y << ", " << z << ";\n";
+}
+
+static void writeMaterial(ostream &output, generatorRandom &random, int id, int family)
+{
+    output << "Material" << id << "\n{\n";
+    switch (family)
+    {
+    case familyTurbulence:
+    case familyMarble:
+        output << "  Type = " << (family == familyMarble ? "marble" : "turbulence") << ";\n";
+        writeRandomColor(output, "Diffuse", random, 0.05f, 0.6f);
+        writeRandomColor(output, "Diffuse2", random, 0.0f, 0.5f);
+        output << "  Density = 1.0;\n  Reflection = " << random.range(0.0f, 0.1f) << ";\n  Refraction = 0.0;\n";
+        break;
+    case familyGlass:
+        output << "  Type = gouraud;\n";
+        writeColor(output, "Diffuse", 0.0f, 0.0f, 0.0f);
+        output << "  Bumplevel = " << random.range(0.0f, 0.1f) << ";\n";
+        output << "  Density = " << random.range(1.3f, 2.0f) << ";\n  Reflection = 0.9;\n  Refraction = 0.9;\n";
+        break;
+    default:
+        output << "  Type = gouraud;\n";
+        writeRandomColor(output, "Diffuse", random, 0.05f, 0.6f);
+        output << "  Density = 0.0;\n  Reflection = " << random.range(0.0f, 0.5f) << ";\n  Refraction = 0.0;\n";
+        break;
+    }
+    writeColor(output, "Specular", 1.2f, 1.2f, 1.2f);
+    output << "  Power = 60;\n}\n";
+}
+
+static bool writeScene(ostream &output, const generatorParameters &params)
+{
+    generatorRandom random(params.seed);
+    const int nbMaterials = familyCount * variantsPerFamily;
+    // Objects fill a box in front of the camera, they get smaller as there are more of them
+    const float depth = float(params.width);
+    const float zStart = 0.5f * float(params.width);
+    const int nbObjects = params.nbSpheres + params.nbBlobs;
+    const float objectSize = max(2.0f, 0.15f * float(params.width) / cbrtf(float(max(nbObjects, 1))));
+
+    output << "// Generated by scenegen";
+    output << " --spheres " << params.nbSpheres << " --blobs " << params.nbBlobs 
+           << " --centers " << params.nbCenters << " --lights " << params.nbLights
+           << " --mix " << params.mix[0] << "," << params.mix[1] << "," << params.mix[2] << "," << params.mix[3]
+           << " --width " << params.width << " --height " << params.height
+           << " --complexity " << params.complexity << " --dof " << params.dispersion
+           << " --seed " << params.seed << (params.bCubemap ? "" : " --no-cubemap") << "\n\n";
+
+    output << "Scene\n{\n"
+           << "  Version.Major = 1;\n  Version.Minor = 3;\n"
+           << "  Image.Width = " << params.width << ";\n"
+           << "  Image.Height = " << params.height << ";\n"
+           << "  Perspective.Type = conic;\n  Perspective.FOV = 90.0;\n"
+           << "  Perspective.ClearPoint = " << zStart + 0.5f * depth << ";\n"
+           << "  Perspective.Dispersion = " << params.dispersion << ";\n"
+           << "  Tonemap.Midpoint = 0.7;\n  Tonemap.Power = 3.0;\n  Tonemap.Black = 0.1;\n"
+           << "  NumberOfMaterials = " << nbMaterials << ";\n"
+           << "  NumberOfSpheres = " << params.nbSpheres << ";\n"
+           << "  NumberOfBlobs = " << params.nbBlobs << ";\n"
+           << "  NumberOfLights = " << params.nbLights << ";\n"
+           << "  Complexity = " << params.complexity << ";\n";
+    if (params.bCubemap)
+    {
+        output << "  Cubemap.Up = alpup.tga;\n  Cubemap.Down = alpdown.tga;\n"
+               << "  Cubemap.Right = alpright.tga;\n  Cubemap.Left = alpleft.tga;\n"
+               << "  Cubemap.Forward = alpforward.tga;\n  Cubemap.Backward = alpback.tga;\n"
+               << "  Cubemap.Exposed = true;\n  Cubemap.sRGB = true;\n";
+    }
+    output << "}\n\n";
+
+    for (int i = 0; i < nbMaterials; ++i)
+    {
+        writeMaterial(output, random, i, i / variantsPerFamily);
+    }
+    for (int i = 0; i < params.nbSpheres; ++i)
+    {
+        output << "Sphere" << i << "\n{\n";
+        writeRandomPoint(output, "Center", random, 0.0f, float(params.width), 
+                         0.0f, float(params.height), zStart, zStart + depth);
+        output << "  Size = " << random.range(0.5f, 1.5f) * objectSize << ";\n";
+        output << "  Material.Id = " << pickMaterial(random, params) << ";\n}\n";
+    }
+    for (int i = 0; i < params.nbBlobs; ++i)
+    {
+        float x = random.range(0.0f, float(params.width));
+        float y = random.range(0.0f, float(params.height));
+        float z = random.range(zStart, zStart + depth);
+        float size = random.range(1.0f, 2.0f) * objectSize;
+        output << "Blob" << i << "\n{\n";
+        for (int j = 0; j < params.nbCenters; ++j)
+        {
+            char name[32];
+            sprintf(name, "Center%d", j);
+            writeRandomPoint(output, name, random, x - size, x + size, y - size, y + size, z - size, z + size);
+        }
+        output << "  Size = " << size << ";\n";
+        output << "  Material.Id = " << pickMaterial(random, params) << ";\n}\n";
+    }
+    for (int i = 0; i < params.nbLights; ++i)
+    {
+        output << "Light" << i << "\n{\n";
+        writeRandomPoint(output, "Position", random, 0.0f, float(params.width), 
+                         0.0f, float(params.height), -0.5f * depth, zStart);
+        writeRandomColor(output, "Intensity", random, 1.0f, 5.0f);
+        output << "}\n";
+    }
+    return bool(output);
+}
+
+static void usage()
+{
+    cout << "Usage : scenegen [options] Output.txt" << endl
+         << "  --spheres N       number of spheres (20)" << endl
+         << "  --blobs N         number of blobs (2)" << endl
+         << "  --centers N       centers per blob (3)" << endl
+         << "  --lights N        number of lights (2)" << endl
+         << "  --mix g,t,m,glass relative weights of gouraud, turbulence, marble and glass (1,1,1,1)" << endl
+         << "  --width N         image width (640)" << endl
+         << "  --height N        image height (480)" << endl
+         << "  --complexity N    samples per fragment (1)" << endl
+         << "  --dof D           lens dispersion, 0 disables depth of field (0)" << endl
+         << "  --seed N          random seed (1)" << endl
+         << "  --no-cubemap      no environment map" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+    generatorParameters params = {20, 2, 3, 2, {1.0f, 1.0f, 1.0f, 1.0f}, 640, 480, 1, 0.0f, 1, true};
+    const char *outputName = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *option = argv[i];
+        bool bHasValue = (i + 1 < argc);
+        if (strcmp(option, "--no-cubemap") == 0)
+            params.bCubemap = false;
+        else if (strcmp(option, "--spheres") == 0 && bHasValue)
+            params.nbSpheres = atoi(argv[++i]);
+        else if (strcmp(option, "--blobs") == 0 && bHasValue)
+            params.nbBlobs = atoi(argv[++i]);
+        else if (strcmp(option, "--centers") == 0 && bHasValue)
+            params.nbCenters = atoi(argv[++i]);
+        else if (strcmp(option, "--lights") == 0 && bHasValue)
+            params.nbLights = atoi(argv[++i]);
+        else if (strcmp(option, "--width") == 0 && bHasValue)
+            params.width = atoi(argv[++i]);
+        else if (strcmp(option, "--height") == 0 && bHasValue)
+            params.height = atoi(argv[++i]);
+        else if (strcmp(option, "--complexity") == 0 && bHasValue)
+            params.complexity = atoi(argv[++i]);
+        else if (strcmp(option, "--dof") == 0 && bHasValue)
+            params.dispersion = float(atof(argv[++i]));
+        else if (strcmp(option, "--seed") == 0 && bHasValue)
+            params.seed = unsigned(strtoul(argv[++i], NULL, 10));
+        else if (strcmp(option, "--mix") == 0 && bHasValue)
+        {
+            if (sscanf(argv[++i], "%f,%f,%f,%f", &params.mix[0], &params.mix[1], &params.mix[2], &params.mix[3]) != 4)
+            {
+                usage();
+                return -1;
+            }
+        }
+        else if (option[0] != '-' && outputName == NULL)
+            outputName = option;
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+
+    float totalMix = params.mix[0] + params.mix[1] + params.mix[2] + params.mix[3];
+    if (outputName == NULL || params.nbSpheres < 0 || params.nbBlobs < 0 || params.nbCenters < 1 ||
+        params.nbLights < 0 || params.width <= 0 || params.height <= 0 || params.complexity < 1 || 
+        params.dispersion < 0.0f || !(totalMix > 0.0f))
+    {
+        usage();
+        return -1;
+    }
+
+    ofstream outputFile(outputName);
+    if (!outputFile || !writeScene(outputFile, params))
+    {
+        cout << "Failure when writing the scene file." << endl;
+        return -1;
+    }
+    return 0;
+}